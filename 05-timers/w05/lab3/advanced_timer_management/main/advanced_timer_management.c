@@ -14,6 +14,7 @@
 #include "esp_system.h"
 #include "esp_random.h"
 #include "driver/gpio.h"
+#include "soa.h"
 
 static const char *TAG = "ADV_TIMERS";
 
@@ -25,6 +26,7 @@ static const char *TAG = "ADV_TIMERS";
 #define TIMER_POOL_SIZE              20
 #define DYNAMIC_TIMER_MAX            10
 #define PERFORMANCE_BUFFER_SIZE      100
+#define LAYOUT_BENCH_SCANS           1000
 #define HEALTH_CHECK_INTERVAL        1000
 
 // LEDs for visual feedback
@@ -50,7 +52,7 @@ typedef struct {
     uint32_t callback_count;
 } timer_pool_entry_t;
 
-// Performance Metrics
+// Performance Metrics (array-of-structs row; kept for the layout benchmark)
 typedef struct {
     uint32_t callback_start_time;
     uint32_t callback_duration_us;
@@ -60,6 +62,21 @@ typedef struct {
     bool accuracy_ok;
 } performance_sample_t;
 
+// Samples as a structure-of-arrays ring: analyze_performance() reads only the
+// hot columns, the rest of each sample stays in the cold struct
+#define PERF_SAMPLE_COLUMNS(X, arg) \
+    X(uint32_t, callback_duration_us, arg) \
+    X(bool, accuracy_ok, arg)
+
+typedef struct {
+    uint32_t callback_start_time;
+    uint32_t timer_id;
+    BaseType_t service_task_priority;
+    uint32_t queue_length;
+} performance_sample_cold_t;
+
+SOA_DECLARE(perf_samples, PERF_SAMPLE_COLUMNS, performance_sample_cold_t)
+
 // System Health Data
 typedef struct {
     uint32_t total_timers_created;
@@ -82,8 +99,9 @@ SemaphoreHandle_t pool_mutex;
 uint32_t next_timer_id = 1000;
 
 // Performance Monitoring
-performance_sample_t perf_buffer[PERFORMANCE_BUFFER_SIZE];
-uint32_t perf_buffer_index = 0;
+static uint8_t perf_storage[SOA_STATIC_BYTES(PERF_SAMPLE_COLUMNS, performance_sample_cold_t,
+                                               PERFORMANCE_BUFFER_SIZE)] SOA_STORAGE_ALIGN;
+perf_samples_t perf_samples;
 SemaphoreHandle_t perf_mutex;
 
 // Health Monitoring
@@ -193,16 +211,15 @@ void release_to_pool(uint32_t timer_id) {
 // ================ PERFORMANCE MONITORING ================
 void record_performance_sample(uint32_t timer_id, uint32_t duration_us, bool accuracy_ok) {
     if (xSemaphoreTake(perf_mutex, 0) == pdTRUE) { // Non-blocking
-        performance_sample_t* sample = &perf_buffer[perf_buffer_index];
-
-        sample->timer_id = timer_id;
-        sample->callback_duration_us = duration_us;
-        sample->accuracy_ok = accuracy_ok;
-        sample->callback_start_time = esp_timer_get_time() / 1000; // Convert to ms
-        sample->service_task_priority = uxTaskPriorityGet(NULL);
-        sample->queue_length = 0; // Would need special access to get this
+        const uint32_t slot = perf_samples_push(&perf_samples);
+        performance_sample_cold_t* cold = &perf_samples.cold[slot];
 
-        perf_buffer_index = (perf_buffer_index + 1) % PERFORMANCE_BUFFER_SIZE;
+        perf_samples.callback_duration_us[slot] = duration_us;
+        perf_samples.accuracy_ok[slot] = accuracy_ok;
+        cold->timer_id = timer_id;
+        cold->callback_start_time = esp_timer_get_time() / 1000; // Convert to ms
+        cold->service_task_priority = uxTaskPriorityGet(NULL);
+        cold->queue_length = 0; // Would need special access to get this
 
         if (duration_us > 1000) { // > 1ms is concerning
             health_data.callback_overruns++;
@@ -222,20 +239,22 @@ void analyze_performance(void) {
     uint32_t min_duration = UINT32_MAX;
     uint32_t accurate_timers = 0;
     uint32_t sample_count = 0;
+    const uint32_t* duration = perf_samples_col_callback_duration_us(&perf_samples);
+    const bool* accuracy_ok = perf_samples_col_accuracy_ok(&perf_samples);
 
-    for (int i = 0; i < PERFORMANCE_BUFFER_SIZE; i++) {
-        if (perf_buffer[i].callback_duration_us > 0) {
-            total_duration += perf_buffer[i].callback_duration_us;
+    for (uint32_t i = 0; i < perf_samples.count; i++) {
+        if (duration[i] > 0) {
+            total_duration += duration[i];
 
-            if (perf_buffer[i].callback_duration_us > max_duration) {
-                max_duration = perf_buffer[i].callback_duration_us;
+            if (duration[i] > max_duration) {
+                max_duration = duration[i];
             }
 
-            if (perf_buffer[i].callback_duration_us < min_duration) {
-                min_duration = perf_buffer[i].callback_duration_us;
+            if (duration[i] < min_duration) {
+                min_duration = duration[i];
             }
 
-            if (perf_buffer[i].accuracy_ok) {
+            if (accuracy_ok[i]) {
                 accurate_timers++;
             }
 
@@ -261,6 +280,53 @@ void analyze_performance(void) {
     xSemaphoreGive(perf_mutex);
 }
 
+// Same duration/accuracy scan over the old array-of-structs layout and the
+// structure-of-arrays ring, on identical data
+void benchmark_perf_layout(void) {
+    static performance_sample_t aos[PERFORMANCE_BUFFER_SIZE];
+    for (int i = 0; i < PERFORMANCE_BUFFER_SIZE; i++) {
+        const uint32_t slot = perf_samples_push(&perf_samples);
+        aos[i].callback_duration_us = perf_samples.callback_duration_us[slot] = 50 + esp_random() % 900;
+        aos[i].accuracy_ok = perf_samples.accuracy_ok[slot] = esp_random() % 10 != 0;
+    }
+
+    volatile uint32_t sink = 0;
+    uint64_t start = esp_timer_get_time();
+    for (int r = 0; r < LAYOUT_BENCH_SCANS; r++) {
+        uint32_t total = 0, accurate = 0;
+        for (int i = 0; i < PERFORMANCE_BUFFER_SIZE; i++) {
+            if (aos[i].callback_duration_us > 0) {
+                total += aos[i].callback_duration_us;
+                accurate += aos[i].accuracy_ok;
+            }
+        }
+        sink += total + accurate;
+    }
+    const uint64_t aos_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int r = 0; r < LAYOUT_BENCH_SCANS; r++) {
+        const uint32_t* duration = perf_samples_col_callback_duration_us(&perf_samples);
+        const bool* accuracy_ok = perf_samples_col_accuracy_ok(&perf_samples);
+        uint32_t total = 0, accurate = 0;
+        for (int i = 0; i < PERFORMANCE_BUFFER_SIZE; i++) {
+            if (duration[i] > 0) {
+                total += duration[i];
+                accurate += accuracy_ok[i];
+            }
+        }
+        sink += total + accurate;
+    }
+    const uint64_t soa_us = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "📐 perf scan (%d samples): AoS %.2f μs (%d B/row) → SoA %.2f μs (%d B/row hot)",
+             PERFORMANCE_BUFFER_SIZE, (float)aos_us / LAYOUT_BENCH_SCANS, (int)sizeof(performance_sample_t),
+             (float)soa_us / LAYOUT_BENCH_SCANS, (int)(sizeof(uint32_t) + sizeof(bool)));
+
+    // Start real monitoring from an empty ring
+    perf_samples_bind(&perf_samples, perf_storage, PERFORMANCE_BUFFER_SIZE);
+}
+
 // ================ TIMER CALLBACKS ================
 void performance_test_callback(TimerHandle_t timer) {
     uint32_t start_time = esp_timer_get_time();
@@ -488,7 +554,9 @@ void init_monitoring(void) {
     test_result_queue = xQueueCreate(20, sizeof(uint32_t));
 
     // Clear performance buffer
-    memset(perf_buffer, 0, sizeof(perf_buffer));
+    memset(perf_storage, 0, sizeof(perf_storage));
+    perf_samples_bind(&perf_samples, perf_storage, PERFORMANCE_BUFFER_SIZE);
+    benchmark_perf_layout();
 
     ESP_LOGI(TAG, "Monitoring systems initialized");
 }
@@ -13,6 +13,7 @@
 #include "esp_random.h"
 #include "esp_timer.h"
 #include "driver/gpio.h"
+#include "soa.h"
 
 static const char *TAG = "COMPLEX_EVENTS";
 
@@ -76,14 +77,30 @@ static SemaphoreHandle_t state_mutex;
 
 // Event History สำหรับ Pattern Recognition
 #define EVENT_HISTORY_SIZE 20
+#define LAYOUT_BENCH_SCANS 10000
+
+// Array-of-structs row (kept for the layout benchmark)
 typedef struct {
     EventBits_t event_bits;
     uint64_t timestamp;
     home_state_t state_at_time;
 } event_record_t;
 
-static event_record_t event_history[EVENT_HISTORY_SIZE];
-static int history_index = 0;
+// History as a structure-of-arrays ring: pattern matching scans only
+// timestamp + event_bits, newest first
+#define EVENT_HISTORY_COLUMNS(X, arg) \
+    X(uint64_t, timestamp, arg) \
+    X(EventBits_t, event_bits, arg)
+
+typedef struct {
+    home_state_t state_at_time;
+} event_record_cold_t;
+
+SOA_DECLARE(event_history, EVENT_HISTORY_COLUMNS, event_record_cold_t)
+
+static uint8_t event_history_storage[SOA_STATIC_BYTES(EVENT_HISTORY_COLUMNS, event_record_cold_t,
+                                                      EVENT_HISTORY_SIZE)] SOA_STORAGE_ALIGN;
+static event_history_t event_history;
 
 // Pattern Recognition Data
 typedef struct {
@@ -255,10 +272,63 @@ void change_home_state(home_state_t new_state) {
 
 // ========= Event History =========
 void add_event_to_history(EventBits_t event_bits) {
-    event_history[history_index].event_bits = event_bits;
-    event_history[history_index].timestamp = esp_timer_get_time();
-    event_history[history_index].state_at_time = current_home_state;
-    history_index = (history_index + 1) % EVENT_HISTORY_SIZE;
+    const uint32_t slot = event_history_push(&event_history);
+    event_history.event_bits[slot] = event_bits;
+    event_history.timestamp[slot] = esp_timer_get_time();
+    event_history.cold[slot].state_at_time = current_home_state;
+}
+
+// Newest-first windowed scan (as in adaptive learning) over the old
+// array-of-structs layout and the SoA ring, on identical data. 20 events fit
+// in cache either way, so expect the two to come out close.
+void benchmark_history_layout(void) {
+    static event_record_t aos[EVENT_HISTORY_SIZE];
+    const uint64_t base = esp_timer_get_time();
+    for (int i = 0; i < EVENT_HISTORY_SIZE; i++) {
+        add_event_to_history(1 << (esp_random() % 9));
+        aos[i].event_bits = event_history.event_bits[i];
+        aos[i].timestamp = event_history.timestamp[i] = base + i * 1000;
+        aos[i].state_at_time = current_home_state;
+    }
+
+    // Both loops walk the same slots in the same order (aos[i] mirrors ring slot i),
+    // so only the layout differs
+    volatile uint32_t sink = 0;
+    uint64_t start = esp_timer_get_time();
+    for (int r = 0; r < LAYOUT_BENCH_SCANS; r++) {
+        uint32_t motion = 0;
+        for (uint32_t h = 0; h < event_history.count; h++) {
+            const uint32_t idx = event_history_recent(&event_history, h);
+            const event_record_t* rec = &aos[idx];
+            if ((base + EVENT_HISTORY_SIZE * 1000 - rec->timestamp) < 300000000ULL) {
+                if (rec->event_bits & MOTION_DETECTED_BIT) motion++;
+            } else break;
+        }
+        sink += motion;
+    }
+    const uint64_t aos_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int r = 0; r < LAYOUT_BENCH_SCANS; r++) {
+        const uint64_t* timestamp = event_history_col_timestamp(&event_history);
+        const EventBits_t* event_bits = event_history_col_event_bits(&event_history);
+        uint32_t motion = 0;
+        for (uint32_t h = 0; h < event_history.count; h++) {
+            const uint32_t idx = event_history_recent(&event_history, h);
+            if ((base + EVENT_HISTORY_SIZE * 1000 - timestamp[idx]) < 300000000ULL) {
+                if (event_bits[idx] & MOTION_DETECTED_BIT) motion++;
+            } else break;
+        }
+        sink += motion;
+    }
+    const uint64_t soa_us = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "📐 History scan (%d events): AoS %.3f μs (%d B/row) → SoA %.3f μs (%d B/row hot)",
+             EVENT_HISTORY_SIZE, (float)aos_us / LAYOUT_BENCH_SCANS, (int)sizeof(event_record_t),
+             (float)soa_us / LAYOUT_BENCH_SCANS, (int)(sizeof(uint64_t) + sizeof(EventBits_t)));
+
+    // Real history starts empty
+    event_history_bind(&event_history, event_history_storage, EVENT_HISTORY_SIZE);
 }
 
 // ========= Pattern Recognition Engine =========
@@ -292,12 +362,13 @@ void pattern_recognition_task(void *pvParameters) {
                 bool found_all = false;
                 uint64_t now = esp_timer_get_time();
                 int need_idx = 0;
+                const uint64_t* timestamp = event_history_col_timestamp(&event_history);
+                const EventBits_t* event_bits = event_history_col_event_bits(&event_history);
 
-                for (int h = 0; h < EVENT_HISTORY_SIZE && pattern->required_events[need_idx] != 0; h++) {
-                    int hist_idx = (history_index - 1 - h + EVENT_HISTORY_SIZE) % EVENT_HISTORY_SIZE;
-                    event_record_t* rec = &event_history[hist_idx];
-                    if ((now - rec->timestamp) > (pattern->time_window_ms * 1000ULL)) break;
-                    if (rec->event_bits & pattern->required_events[need_idx]) {
+                for (uint32_t h = 0; h < event_history.count && pattern->required_events[need_idx] != 0; h++) {
+                    const uint32_t hist_idx = event_history_recent(&event_history, h);
+                    if ((now - timestamp[hist_idx]) > (pattern->time_window_ms * 1000ULL)) break;
+                    if (event_bits[hist_idx] & pattern->required_events[need_idx]) {
                         need_idx++;
                         ESP_LOGI(TAG, "✅ Pattern '%s': matched step %d (0x%08X)",
                                  pattern->name, need_idx, pattern->required_events[need_idx-1]);
@@ -483,11 +554,12 @@ void adaptive_learning_task(void *pvParameters) {
             }
             uint32_t recent_motion = 0;
             uint64_t now = esp_timer_get_time();
-            for (int h = 0; h < EVENT_HISTORY_SIZE; h++) {
-                int idx = (history_index - 1 - h + EVENT_HISTORY_SIZE) % EVENT_HISTORY_SIZE;
-                event_record_t* rec = &event_history[idx];
-                if ((now - rec->timestamp) < 300000000ULL) {
-                    if (rec->event_bits & MOTION_DETECTED_BIT) recent_motion++;
+            const uint64_t* timestamp = event_history_col_timestamp(&event_history);
+            const EventBits_t* event_bits = event_history_col_event_bits(&event_history);
+            for (uint32_t h = 0; h < event_history.count; h++) {
+                const uint32_t idx = event_history_recent(&event_history, h);
+                if ((now - timestamp[idx]) < 300000000ULL) {
+                    if (event_bits[idx] & MOTION_DETECTED_BIT) recent_motion++;
                 } else break;
             }
             if (recent_motion > 10) {
@@ -615,6 +687,10 @@ void app_main(void) {
     xEventGroupSetBits(system_events, SYSTEM_INIT_BIT);
     change_home_state(HOME_STATE_IDLE);
 
+    // Event history (SoA ring) + layout comparison
+    event_history_bind(&event_history, event_history_storage, EVENT_HISTORY_SIZE);
+    benchmark_history_layout();
+
     // Core tasks
     xTaskCreate(pattern_recognition_task, "PatternEngine", 4096, NULL, 8, NULL);
     xTaskCreate(state_machine_task,       "StateMachine",   3072, NULL, 7, NULL);
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include "freertos/FreeRTOS.h"
@@ -12,6 +13,18 @@
 #include "esp_system.h"
 #include "driver/gpio.h"
 #include "esp_random.h"
+#include "esp_memory_utils.h"
+#include "esp_cpu.h"
+#include "soa.h"
+
+// Heap interposition: main/CMakeLists.txt sets this and wraps the allocator
+// entry points at link time (idf.py -DHEAP_INTERPOSE=OFF build to disable)
+#ifndef HEAP_INTERPOSE_ENABLED
+#define HEAP_INTERPOSE_ENABLED  0
+#endif
+#if HEAP_INTERPOSE_ENABLED
+#include "esp_attr.h"
+#endif
 
 static const char *TAG = "HEAP_MGMT";
 
@@ -26,18 +39,116 @@ static const char *TAG = "HEAP_MGMT";
 #define LOW_MEMORY_THRESHOLD    50000    // 50KB
 #define CRITICAL_MEMORY_THRESHOLD 20000  // 20KB
 #define FRAGMENTATION_THRESHOLD 0.3      // 30% fragmentation
-#define MAX_ALLOCATIONS         100
+#define MAX_ALLOCATIONS         10240    // tracked live allocations (halved at init until it fits)
+#define MIN_TRACKED_ALLOCATIONS 256
+#define TRACK_OVERFLOW_LOG_EVERY 1000    // log 1 of every N untracked allocations
+#define SUMMARY_MAX_LINES       20       // allocations listed by summary / leak report
+
+// Heap interposition (whole program, per call site)
+#define INTERPOSE_SITES         64       // call sites tracked (power of 2), site 0 = "<other>"
+#define INTERPOSE_LIVE_SLOTS    2048     // live-block slots (power of 2), filled to 75% at most
+#define INTERPOSE_TOP_N         8
+
+// Tracking cost benchmark
+#define TRACK_BENCH_BLOCK_SIZE  16
+#define TRACK_BENCH_PAIRS       500      // malloc+free pairs timed per live-count level
+#define TRACK_LAYOUT_ROWS       1024     // records in the AoS vs SoA scan comparison
+#define TRACK_LAYOUT_SCANS      100
+
+// Epoch-based leak detection: one epoch per monitor cycle
+#define LEAK_SURVIVE_EPOCHS     3        // born in epoch E and still live after E+N -> suspect
+#define LEAK_WINDOW_EPOCHS      6        // birth epochs examined per report
+#define LEAK_MIN_RECURRING      2        // suspect epochs needed to call a site a leak
+#define LEAK_EPOCH_HISTORY      (LEAK_SURVIVE_EPOCHS + LEAK_WINDOW_EPOCHS + 1)
+#define LEAK_GROUPS             16       // call sites per report, the last one collects the rest
+#define LEAK_SCAN_CHUNK         256      // records walked per memory_mutex hold
+#define LEAK_DEMO_BLOCK_SIZE    48       // LeakDemo task: slow leak per cycle
+#define LEAK_DEMO_MAX_BLOCKS    100      // ... released and restarted after this many
+#define LEAK_DEMO_BLOB_SIZE     (24 * 1024)  // ... plus one long-lived buffer (not a leak)
+
+// Per-task heap accounting
+#define TASK_ACCOUNT_MAX        24       // tasks tracked, the last slot collects the rest
+#define TASK_ACCOUNT_OTHER      (TASK_ACCOUNT_MAX - 1)
+#define TASK_QUOTA_LOG_EVERY    50       // log 1 of every N quota rejections per task
+#define RUNAWAY_QUOTA           (16 * 1024)  // demo: internal-RAM budget of the Runaway task
+#define RUNAWAY_BLOCK_SIZE      1024
+
+// Relocatable handle-based buffers
+#define MOVABLE_ARENA_MAX       4        // arenas visited by the compactor
+#define MOVABLE_HANDLES         128      // live blocks per arena
+#define MOVABLE_ALIGN           8
+#define COMPACT_CHECK_MS        100
+#define COMPACT_STEP_BYTES      4096     // bytes moved per compactor step (bounds the pause)
+#define SOAK_REGION_SIZE        (16 * 1024)
+#define SOAK_MAX_LIVE           40       // ~60% of the region at the average size
+#define SOAK_OPS                4000
+#define SOAK_REPORT_EVERY       250
+
+// Memory-pressure shrinkers (internal RAM watermarks)
+#define SHRINKER_MAX            8
+#define SHRINK_LOW_WATERMARK    LOW_MEMORY_THRESHOLD            // start shrinking below this
+#define SHRINK_HIGH_WATERMARK   (LOW_MEMORY_THRESHOLD + 20000)  // ... until free is back above this
+#define SHRINK_CHECK_MS         500
+#define READING_CACHE_ENTRIES   32       // demo cache: 512-byte readings, oldest dropped first
+#define READING_CACHE_ENTRY_SIZE 512
+#define EVENT_LOG_LINES         64       // demo log ring: halves under pressure, down to 8 lines
+#define EVENT_LOG_MIN_LINES     8
+#define EVENT_LOG_LINE_SIZE     64
 
-// Memory allocation tracking
+// Binary heap event trace (decoded offline by tools/heap_trace.py)
+#define HEAP_TRACE_RING_SIZE    256      // events (power of 2)
+#define HEAP_TRACE_BATCH        24       // events per output line / write
+#define HEAP_TRACE_DRAIN_MS     100
+#define HEAP_TRACE_SNAPSHOT_MS  1000     // free bytes / largest block snapshot period
+#define HEAP_TRACE_TASKS        32
+#define HEAP_TRACE_VERSION      1
+#define HEAP_TRACE_TASK_UNKNOWN 0xFF
+
+// Memory allocation tracking (array-of-structs row; kept for the layout benchmark)
 typedef struct {
-    void* ptr;
+    void* ptr;              // NULL while the record is free
     size_t size;
     uint32_t caps;
     const char* description;
     uint64_t timestamp;
-    bool is_active;
+    const void* site;       // caller of tracked_malloc
+    uint32_t epoch : 23;    // leak-detection epoch the block was born in
+    uint32_t internal : 1;  // block is in internal RAM (counts against the owner's quota)
+    uint32_t owner : 8;     // task_accounts[] index of the allocating task
 } memory_allocation_t;
 
+// The tracker stores records as a structure-of-arrays table: index probes and
+// the leak scan read only ptr and epoch, the rest is touched per hit
+#define TRACK_RECORD_COLUMNS(X, arg) \
+    X(void*, ptr, arg)          /* NULL while the record is free */ \
+    X(uint32_t, epoch, arg)     /* leak-detection epoch the block was born in */
+
+typedef struct {
+    size_t size;
+    uint32_t caps;
+    const char* description;
+    uint64_t timestamp;
+    const void* site;       // caller of tracked_malloc
+    uint32_t internal : 1;  // block is in internal RAM (counts against the owner's quota)
+    uint32_t owner : 8;     // task_accounts[] index of the allocating task
+} memory_allocation_cold_t;
+
+SOA_DECLARE(track_records, TRACK_RECORD_COLUMNS, memory_allocation_cold_t)
+
+// Records plus an open-addressing pointer index (linear probing, backward-shift
+// delete) and a stack of free records: insert, lookup and remove are O(1)
+// expected, independent of how many allocations are live.
+typedef struct {
+    track_records_t records;    // columns carved out of record_storage
+    void* record_storage;
+    uint16_t* free_stack;       // free record indices
+    uint16_t* index;            // hash slot -> record + 1, 0 = empty
+    uint32_t capacity;          // records (< 65536, index entries are 16-bit)
+    uint32_t index_mask;        // hash slots - 1, at least 2x capacity
+    uint32_t free_top;
+    uint32_t untracked_live;    // overflow allocations that got no record
+} allocation_tracker_t;
+
 // Memory statistics
 typedef struct {
     uint32_t total_allocations;
@@ -49,48 +160,537 @@ typedef struct {
     uint32_t allocation_failures;
     uint32_t fragmentation_events;
     uint32_t low_memory_events;
+    uint32_t tracking_overflows;    // allocations made while the tracker was full
 } memory_stats_t;
 
+typedef enum {
+    HEAP_EV_ALLOC = 1,
+    HEAP_EV_FREE,
+    HEAP_EV_FAIL,       // allocation failed: size, caps
+    HEAP_EV_TASK,       // task index announcement: name
+    HEAP_EV_HEAP,       // snapshot: ptr = free bytes, size = largest free block
+    HEAP_EV_DROPPED,    // ptr = events lost because the ring was full
+} heap_event_op_t;
+
+// 20-byte little-endian record, the format tools/heap_trace.py reads
+typedef struct {
+    uint32_t timestamp_us;      // esp_timer, wraps every ~71 minutes
+    union {
+        struct {
+            uint32_t ptr;
+            uint32_t size;
+            uint32_t caps;
+        };
+        char name[12];          // HEAP_EV_TASK
+    };
+    uint16_t seq;               // ring position, a gap means lost output
+    uint8_t op;
+    uint8_t task;               // index announced by HEAP_EV_TASK
+} heap_event_t;
+
+_Static_assert(sizeof(heap_event_t) == 20, "tools/heap_trace.py expects 20-byte records");
+
+// Bounded multi-producer ring (per-cell sequence numbers): producers claim a
+// cell with one CAS and never wait; when it is full the event is dropped and
+// counted. Only the drain task consumes.
+typedef struct {
+    uint32_t sequence;
+    heap_event_t ev;
+} heap_trace_cell_t;
+
+typedef struct {
+    heap_trace_cell_t cells[HEAP_TRACE_RING_SIZE];
+    uint32_t enqueue_pos;
+    uint32_t dequeue_pos;       // written by the drain task only
+    uint32_t emitted;
+    uint32_t dropped;
+    TaskHandle_t tasks[HEAP_TRACE_TASKS];
+    TaskHandle_t drain_task;    // woken early when the ring is half full
+    bool ready;
+} heap_trace_t;
+
+// Over-quota policy: fail the allocation, or divert it to PSRAM when the
+// caller did not ask for internal/DMA memory (fails when there is no PSRAM)
+typedef enum {
+    TASK_QUOTA_FAIL,
+    TASK_QUOTA_DIVERT,
+} task_quota_policy_t;
+
+typedef struct {
+    TaskHandle_t task;          // slots are appended, never reused
+    char name[16];
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t internal_bytes;      // live bytes in internal RAM, limited by quota
+    uint32_t live_blocks;
+    uint32_t allocs;
+    uint32_t quota_rejects;
+    uint32_t quota_diverted;
+    size_t quota;               // internal-RAM bytes, 0 = unlimited
+    task_quota_policy_t policy;
+} task_account_t;
+
+typedef struct {
+    uint32_t current;                           // stamped on new allocations
+    uint64_t started_us[LEAK_EPOCH_HISTORY];    // start time, indexed by epoch % history
+} leak_epochs_t;
+
+typedef struct {
+    const void* site;
+    char label[16];         // description of the first block seen (may be a reused buffer)
+    uint32_t count;
+    size_t bytes;
+    uint32_t epoch_mask;    // bit k: survivors born k epochs into the window
+} leak_group_t;
+
+// Handle = generation << 16 | (slot + 1); 0 is never valid
+typedef uint32_t movable_handle_t;
+#define MOVABLE_HANDLE_NULL     0
+
+typedef struct {
+    uint32_t offset;
+    uint32_t size;          // rounded up to MOVABLE_ALIGN, 0 = slot unused
+    uint16_t pins;          // pinned blocks are never moved
+    uint16_t generation;
+} movable_slot_t;
+
+// Callers hold handles, not pointers; the compactor slides unpinned blocks
+// toward the start of the region so the free space ends up in one piece
+typedef struct {
+    const char* name;
+    uint8_t* region;
+    size_t region_size;
+    movable_slot_t slots[MOVABLE_HANDLES];
+    uint16_t order[MOVABLE_HANDLES];    // used slots sorted by offset
+    int count;
+    bool compaction;                     // visited by the compactor task
+    SemaphoreHandle_t mutex;
+    uint32_t alloc_failures;
+    uint32_t moves;
+    size_t bytes_moved;
+    uint32_t max_pause_us;               // longest single move under the lock
+} movable_arena_t;
+
+// Reclaim callback: free about target_bytes (everything it can when
+// critical) and return the bytes actually released
+typedef size_t (*shrink_fn_t)(size_t target_bytes, bool critical, void* ctx);
+typedef size_t (*shrink_count_fn_t)(void* ctx);     // reclaimable bytes right now
+
+typedef struct {
+    const char* name;
+    int priority;               // lower runs first: cheapest to rebuild
+    shrink_count_fn_t count;
+    shrink_fn_t shrink;
+    void* ctx;
+    uint32_t calls;
+    size_t reclaimed_bytes;
+    uint64_t time_us;
+    uint32_t max_time_us;
+} shrinker_t;
+
+typedef struct {
+    shrinker_t shrinkers[SHRINKER_MAX];     // sorted by priority
+    int count;
+    SemaphoreHandle_t mutex;
+    bool under_pressure;                    // between the watermarks after crossing LOW
+    uint32_t pressure_events;
+    uint32_t critical_events;
+} shrinker_registry_t;
+
 // Global variables
-static memory_allocation_t allocations[MAX_ALLOCATIONS];
+static heap_trace_t heap_trace = {0};
+static shrinker_registry_t shrink_registry = {0};
+static movable_arena_t* movable_arenas[MOVABLE_ARENA_MAX];
+static int movable_arena_count = 0;
+static leak_epochs_t leak_epochs = {0};
+static task_account_t task_accounts[TASK_ACCOUNT_MAX];
+static int task_account_count = 0;         // real tasks in task_accounts[0..count)
+static allocation_tracker_t tracker = {0};
 static memory_stats_t stats = {0};
 static SemaphoreHandle_t memory_mutex;
 static bool memory_monitoring_enabled = true;
 
-// Memory monitoring functions
-int find_free_allocation_slot(void) {
-    for (int i = 0; i < MAX_ALLOCATIONS; i++) {
-        if (!allocations[i].is_active) {
-            return i;
+// Heap event trace
+void heap_trace_init(void) {
+    for (uint32_t i = 0; i < HEAP_TRACE_RING_SIZE; i++) {
+        heap_trace.cells[i].sequence = i;
+    }
+    __atomic_store_n(&heap_trace.ready, true, __ATOMIC_RELEASE);
+}
+
+static bool heap_trace_push(heap_event_t* ev) {
+    uint32_t pos = __atomic_load_n(&heap_trace.enqueue_pos, __ATOMIC_RELAXED);
+    while (1) {
+        heap_trace_cell_t* cell = &heap_trace.cells[pos & (HEAP_TRACE_RING_SIZE - 1)];
+        const int32_t dif = (int32_t)(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&heap_trace.enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                ev->seq = pos;
+                cell->ev = *ev;
+                __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+                __atomic_add_fetch(&heap_trace.emitted, 1, __ATOMIC_RELAXED);
+                if (pos + 1 - __atomic_load_n(&heap_trace.dequeue_pos, __ATOMIC_RELAXED) == HEAP_TRACE_RING_SIZE / 2 &&
+                    heap_trace.drain_task) {
+                    xTaskNotifyGive(heap_trace.drain_task);
+                }
+                return true;
+            }
+        } else if (dif < 0) {
+            __atomic_add_fetch(&heap_trace.dropped, 1, __ATOMIC_RELAXED);   // full
+            return false;
+        } else {
+            pos = __atomic_load_n(&heap_trace.enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static bool heap_trace_pop(heap_event_t* out) {
+    heap_trace_cell_t* cell = &heap_trace.cells[heap_trace.dequeue_pos & (HEAP_TRACE_RING_SIZE - 1)];
+    if (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != heap_trace.dequeue_pos + 1) return false;
+    *out = cell->ev;
+    __atomic_store_n(&cell->sequence, heap_trace.dequeue_pos + HEAP_TRACE_RING_SIZE, __ATOMIC_RELEASE);
+    __atomic_store_n(&heap_trace.dequeue_pos, heap_trace.dequeue_pos + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Small per-task index; the first event of a task announces its name
+static uint8_t heap_trace_task_index(void) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < HEAP_TRACE_TASKS; i++) {
+        TaskHandle_t t = __atomic_load_n(&heap_trace.tasks[i], __ATOMIC_ACQUIRE);
+        if (t == self) return i;
+        if (t == NULL) {
+            if (__atomic_compare_exchange_n(&heap_trace.tasks[i], &t, self, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                heap_event_t ev = { .timestamp_us = (uint32_t)esp_timer_get_time(),
+                                    .op = HEAP_EV_TASK, .task = i };
+                strncpy(ev.name, pcTaskGetName(self), sizeof(ev.name));
+                heap_trace_push(&ev);
+                return i;
+            }
+            if (t == self) return i;
         }
     }
+    return HEAP_TRACE_TASK_UNKNOWN;
+}
+
+static void heap_trace_emit(uint8_t op, const void* ptr, size_t size, uint32_t caps) {
+    if (!__atomic_load_n(&heap_trace.ready, __ATOMIC_ACQUIRE)) return;
+    heap_event_t ev = { .op = op, .task = heap_trace_task_index() };
+    ev.timestamp_us = (uint32_t)esp_timer_get_time();
+    ev.ptr = (uint32_t)(uintptr_t)ptr;
+    ev.size = size;
+    ev.caps = caps;
+    heap_trace_push(&ev);
+}
+
+#if CONFIG_IDF_TARGET_LINUX
+// Host build: raw records after a "HTR1" magic, file from $HEAP_TRACE_FILE
+static FILE* heap_trace_file;
+
+static void heap_trace_output_begin(void) {
+    const char* path = getenv("HEAP_TRACE_FILE");
+    heap_trace_file = fopen(path ? path : "heap_trace.bin", "wb");
+    if (heap_trace_file) fwrite("HTR1", 1, 4, heap_trace_file);
+}
+
+static void heap_trace_output(const heap_event_t* batch, int count) {
+    if (!heap_trace_file) return;
+    fwrite(batch, sizeof(heap_event_t), count, heap_trace_file);
+    fflush(heap_trace_file);
+}
+#else
+// Target: base64 lines on the console ("#HT:..."), so the trace survives
+// alongside the log and can be cut out of an idf.py monitor capture
+static void heap_trace_output_begin(void) {
+    printf("#HT-BEGIN %d %d\n", HEAP_TRACE_VERSION, (int)sizeof(heap_event_t));
+}
+
+static void heap_trace_output(const heap_event_t* batch, int count) {
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static char line[4 * ((HEAP_TRACE_BATCH * sizeof(heap_event_t) + 2) / 3) + 1];
+    const uint8_t* in = (const uint8_t*)batch;
+    const size_t len = count * sizeof(heap_event_t);
+    char* out = line;
+
+    for (size_t i = 0; i < len; i += 3) {
+        const uint32_t v = (in[i] << 16) | ((i + 1 < len ? in[i + 1] : 0) << 8) | (i + 2 < len ? in[i + 2] : 0);
+        *out++ = b64[(v >> 18) & 0x3F];
+        *out++ = b64[(v >> 12) & 0x3F];
+        *out++ = i + 1 < len ? b64[(v >> 6) & 0x3F] : '=';
+        *out++ = i + 2 < len ? b64[v & 0x3F] : '=';
+    }
+    *out = '\0';
+    printf("#HT:%s\n", line);
+}
+#endif
+
+// Low-priority drain: ring -> UART (or file on host), plus periodic heap snapshots
+void heap_trace_drain_task(void *pvParameters) {
+    static heap_event_t batch[HEAP_TRACE_BATCH];
+    uint32_t reported_drops = 0;
+    uint64_t last_snapshot_us = 0;
+
+    ESP_LOGI(TAG, "📼 Heap trace drain started (%d-event ring)", HEAP_TRACE_RING_SIZE);
+    heap_trace_output_begin();
+    heap_trace.drain_task = xTaskGetCurrentTaskHandle();
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HEAP_TRACE_DRAIN_MS));
+
+        const uint64_t now_us = esp_timer_get_time();
+        if (now_us - last_snapshot_us >= HEAP_TRACE_SNAPSHOT_MS * 1000ULL) {
+            multi_heap_info_t info;
+            heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+            heap_trace_emit(HEAP_EV_HEAP, (void*)(uintptr_t)info.total_free_bytes,
+                            info.largest_free_block, MALLOC_CAP_8BIT);
+            last_snapshot_us = now_us;
+        }
+
+        const uint32_t drops = __atomic_load_n(&heap_trace.dropped, __ATOMIC_RELAXED);
+        if (drops != reported_drops) {
+            heap_trace_emit(HEAP_EV_DROPPED, (void*)(uintptr_t)(drops - reported_drops), 0, 0);
+            reported_drops = drops;
+        }
+
+        int count;
+        do {
+            count = 0;
+            while (count < HEAP_TRACE_BATCH && heap_trace_pop(&batch[count])) count++;
+            if (count > 0) heap_trace_output(batch, count);
+        } while (count == HEAP_TRACE_BATCH);
+    }
+}
+
+// Allocation tracker
+static inline uint32_t track_hash(const void* ptr) {
+    return ((uint32_t)(uintptr_t)ptr >> 3) * 2654435761u;   // Fibonacci hashing
+}
+
+// Allocate the tracker, halving the capacity until it fits with LOW_MEMORY_THRESHOLD to spare
+bool tracking_init(void) {
+    memory_mutex = xSemaphoreCreateMutex();
+    shrink_registry.mutex = xSemaphoreCreateMutex();
+    if (!memory_mutex || !shrink_registry.mutex) return false;
+    leak_epochs.started_us[0] = esp_timer_get_time();
+
+    for (uint32_t capacity = MAX_ALLOCATIONS; capacity >= MIN_TRACKED_ALLOCATIONS; capacity /= 2) {
+        uint32_t slots = 1;
+        while (slots < capacity * 2) slots <<= 1;
+        const size_t record_bytes = track_records_bytes(capacity);
+        const size_t bytes = record_bytes + capacity * sizeof(uint16_t) + slots * sizeof(uint16_t);
+
+        // PSRAM first: the table is only touched under memory_mutex, never from ISRs
+        uint32_t caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+        if (heap_caps_get_largest_free_block(caps) < bytes) {
+            caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+            if (heap_caps_get_free_size(caps) < bytes + LOW_MEMORY_THRESHOLD) continue;
+        }
+        tracker.record_storage = heap_caps_aligned_alloc(SOA_ALIGN, record_bytes, caps);
+        tracker.free_stack = heap_caps_malloc(capacity * sizeof(uint16_t), caps);
+        tracker.index = heap_caps_calloc(slots, sizeof(uint16_t), caps);
+        if (tracker.record_storage && tracker.free_stack && tracker.index) {
+            memset(tracker.record_storage, 0, record_bytes);
+            track_records_bind(&tracker.records, tracker.record_storage, capacity);
+            tracker.capacity = capacity;
+            tracker.index_mask = slots - 1;
+            tracker.free_top = 0;
+            for (int i = capacity - 1; i >= 0; i--) tracker.free_stack[tracker.free_top++] = i;
+            ESP_LOGI(TAG, "Allocation tracker: %lu records, %lu index slots, %d bytes in %s",
+                     (unsigned long)capacity, (unsigned long)slots, (int)bytes,
+                     (caps & MALLOC_CAP_SPIRAM) ? "SPIRAM" : "internal RAM");
+            return true;
+        }
+        heap_caps_free(tracker.record_storage);
+        heap_caps_free(tracker.free_stack);
+        heap_caps_free(tracker.index);
+        memset(&tracker, 0, sizeof(tracker));
+    }
+
+    ESP_LOGE(TAG, "No memory for an allocation tracker");
+    vSemaphoreDelete(memory_mutex);
+    memory_mutex = NULL;
+    return false;
+}
+
+// Memory monitoring functions (caller holds memory_mutex)
+int find_free_allocation_slot(void) {
+    return tracker.free_top > 0 ? tracker.free_stack[--tracker.free_top] : -1;
+}
+
+// Hash slot holding ptr, or -1
+static int find_index_slot(const void* ptr) {
+    uint32_t i = track_hash(ptr) & tracker.index_mask;
+    while (tracker.index[i] != 0) {
+        if (tracker.records.ptr[tracker.index[i] - 1] == ptr) return i;
+        i = (i + 1) & tracker.index_mask;
+    }
     return -1;
 }
 
 int find_allocation_by_ptr(void* ptr) {
-    for (int i = 0; i < MAX_ALLOCATIONS; i++) {
-        if (allocations[i].is_active && allocations[i].ptr == ptr) {
-            return i;
-        }
+    const int i = find_index_slot(ptr);
+    return i >= 0 ? tracker.index[i] - 1 : -1;
+}
+
+static void index_insert(int record) {
+    uint32_t i = track_hash(tracker.records.ptr[record]) & tracker.index_mask;
+    while (tracker.index[i] != 0) i = (i + 1) & tracker.index_mask;
+    tracker.index[i] = record + 1;
+}
+
+// Backward-shift delete: pull later entries of the probe run into the hole, so no tombstones build up
+static void index_remove(uint32_t hole) {
+    uint32_t i = hole, j = hole;
+    tracker.index[i] = 0;
+    while (1) {
+        j = (j + 1) & tracker.index_mask;
+        if (tracker.index[j] == 0) return;
+        const uint32_t home = track_hash(tracker.records.ptr[tracker.index[j] - 1]) & tracker.index_mask;
+        // Entry j may move into the hole only if its home slot is not in (i, j]
+        const bool home_between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (home_between) continue;
+        tracker.index[i] = tracker.index[j];
+        tracker.index[j] = 0;
+        i = j;
+    }
+}
+
+// Per-task accounting. Lookups are lock-free: slots are only appended, and
+// task_account_count is published after the slot is filled in.
+static int task_account_find(TaskHandle_t task) {
+    const int count = __atomic_load_n(&task_account_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        if (task_accounts[i].task == task) return i;
     }
     return -1;
 }
 
-void* tracked_malloc(size_t size, uint32_t caps, const char* description) {
-    void* ptr = heap_caps_malloc(size, caps);
+// Caller holds memory_mutex
+static int task_account_get_locked(TaskHandle_t task) {
+    int i = task_account_find(task);
+    if (i >= 0) return i;
+    if (task_account_count == TASK_ACCOUNT_OTHER) return TASK_ACCOUNT_OTHER;
     
-    if (memory_monitoring_enabled && memory_mutex) {
+    i = task_account_count;
+    memset(&task_accounts[i], 0, sizeof(task_accounts[i]));
+    task_accounts[i].task = task;
+    strncpy(task_accounts[i].name, pcTaskGetName(task), sizeof(task_accounts[i].name) - 1);
+    __atomic_store_n(&task_account_count, i + 1, __ATOMIC_RELEASE);
+    return i;
+}
+
+bool task_quota_set(TaskHandle_t task, size_t internal_quota, task_quota_policy_t policy) {
+    if (!task) task = xTaskGetCurrentTaskHandle();
+    if (!memory_mutex || xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    
+    const int i = task_account_get_locked(task);
+    const bool ok = i != TASK_ACCOUNT_OTHER;
+    if (ok) {
+        task_accounts[i].quota = internal_quota;
+        task_accounts[i].policy = policy;
+        ESP_LOGI(TAG, "📏 Quota for %s: %d bytes internal RAM (%s)", task_accounts[i].name, (int)internal_quota,
+                 policy == TASK_QUOTA_DIVERT ? "divert to PSRAM" : "fail");
+    }
+    
+    xSemaphoreGive(memory_mutex);
+    return ok;
+}
+
+// Copy of a task's counters; false if the task never allocated through tracked_malloc
+bool task_heap_get_usage(TaskHandle_t task, task_account_t* out) {
+    if (!memory_mutex || xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    const int i = task_account_find(task ? task : xTaskGetCurrentTaskHandle());
+    if (i >= 0) *out = task_accounts[i];
+    xSemaphoreGive(memory_mutex);
+    return i >= 0;
+}
+
+// vTaskList-style table, one tab-separated row per task:
+// name, live bytes, peak bytes, live blocks, quota (0 = none), rejects, diverted
+void task_heap_list(char* buffer, size_t size) {
+    size_t len = 0;
+    buffer[0] = '\0';
+    if (!memory_mutex || xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    
+    for (int i = 0; i < TASK_ACCOUNT_MAX && len < size; i++) {
+        const task_account_t* a = &task_accounts[i];
+        if (i >= task_account_count && (i != TASK_ACCOUNT_OTHER || a->allocs == 0)) continue;
+        len += snprintf(buffer + len, size - len, "%-15s\t%d\t%d\t%lu\t%d\t%lu\t%lu\n",
+                        i == TASK_ACCOUNT_OTHER ? "<other>" : a->name, (int)a->live_bytes, (int)a->peak_bytes,
+                        (unsigned long)a->live_blocks, (int)a->quota, (unsigned long)a->quota_rejects,
+                        (unsigned long)a->quota_diverted);
+    }
+    
+    xSemaphoreGive(memory_mutex);
+}
+
+void print_task_heap_usage(void) {
+    static char buffer[TASK_ACCOUNT_MAX * 64];   // monitor task only
+    
+    task_heap_list(buffer, sizeof(buffer));
+    ESP_LOGI(TAG, "\n👥 ═══ HEAP USAGE PER TASK ═══");
+    ESP_LOGI(TAG, "Name\t\tLive\tPeak\tBlocks\tQuota\tRejects\tDiverted\n%s", buffer);
+#if configUSE_TRACE_FACILITY && configUSE_STATS_FORMATTING_FUNCTIONS
+    vTaskList(buffer);
+    ESP_LOGI(TAG, "Name\t\tState\tPrio\tStack\tNum\n%s", buffer);
+#endif
+}
+
+// noinline: the return address below must be the caller's, not the caller's caller
+__attribute__((noinline)) void* tracked_malloc(size_t size, uint32_t caps, const char* description) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    task_account_t* acct = NULL;
+    bool over_quota = false;
+    bool diverted = false;
+    
+    // Quota check without the lock: only this task raises its own usage
+    const int acct_index = task_account_find(self);
+    if (acct_index >= 0 && task_accounts[acct_index].quota > 0 && !(caps & MALLOC_CAP_SPIRAM)) {
+        acct = &task_accounts[acct_index];
+        if (acct->internal_bytes + size > acct->quota) {
+            if (acct->policy == TASK_QUOTA_DIVERT && !(caps & (MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA))) {
+                caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+                diverted = true;
+            } else {
+                over_quota = true;
+            }
+        }
+    }
+    
+    void* ptr = over_quota ? NULL : heap_caps_malloc(size, caps);
+    int slot = -1;
+    uint32_t overflows = 0;
+    uint32_t rejects = 0;
+
+    if (over_quota) {
+        rejects = __atomic_add_fetch(&acct->quota_rejects, 1, __ATOMIC_RELAXED);
+    } else if (memory_monitoring_enabled && memory_mutex) {
         if (xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
             if (ptr) {
-                int slot = find_free_allocation_slot();
+                slot = find_free_allocation_slot();
                 if (slot >= 0) {
-                    allocations[slot].ptr = ptr;
-                    allocations[slot].size = size;
-                    allocations[slot].caps = caps;
-                    allocations[slot].description = description;
-                    allocations[slot].timestamp = esp_timer_get_time();
-                    allocations[slot].is_active = true;
+                    memory_allocation_cold_t* rec = &tracker.records.cold[slot];
+                    tracker.records.ptr[slot] = ptr;
+                    tracker.records.epoch[slot] = leak_epochs.current;
+                    rec->size = size;
+                    rec->caps = caps;
+                    rec->description = description;
+                    rec->timestamp = esp_timer_get_time();
+                    rec->site = (const void*)(uintptr_t)esp_cpu_process_stack_pc((uint32_t)(uintptr_t)__builtin_return_address(0));
+                    rec->internal = !esp_ptr_external_ram(ptr);
+                    rec->owner = task_account_get_locked(self);
+                    index_insert(slot);
                     
+                    task_account_t* owner = &task_accounts[rec->owner];
+                    owner->allocs++;
+                    owner->live_blocks++;
+                    owner->live_bytes += size;
+                    if (rec->internal) owner->internal_bytes += size;
+                    if (owner->live_bytes > owner->peak_bytes) owner->peak_bytes = owner->live_bytes;
+                    if (diverted) owner->quota_diverted++;
+
                     stats.total_allocations++;
                     stats.current_allocations++;
                     stats.total_bytes_allocated += size;
@@ -100,50 +700,352 @@ void* tracked_malloc(size_t size, uint32_t caps, const char* description) {
                     if (current_usage > stats.peak_usage) {
                         stats.peak_usage = current_usage;
                     }
-                    
-                    ESP_LOGI(TAG, "✅ Allocated %d bytes at %p (%s) - Slot %d", 
-                             size, ptr, description, slot);
                 } else {
-                    ESP_LOGW(TAG, "⚠️ Allocation tracking full!");
+                    // Tracker full: the allocation still succeeds, it just is not tracked
+                    tracker.untracked_live++;
+                    overflows = ++stats.tracking_overflows;
                 }
             } else {
                 stats.allocation_failures++;
-                ESP_LOGE(TAG, "❌ Failed to allocate %d bytes (%s)", size, description);
             }
             
             xSemaphoreGive(memory_mutex);
         }
     }
+
+    // Log outside memory_mutex
+    if (over_quota) {
+        if (rejects % TASK_QUOTA_LOG_EVERY == 1) {
+            ESP_LOGW(TAG, "⛔ %s over quota (%d/%d bytes): %d bytes (%s) refused, %lu so far",
+                     acct->name, (int)acct->internal_bytes, (int)acct->quota, (int)size, description,
+                     (unsigned long)rejects);
+        }
+    } else if (!ptr) {
+        ESP_LOGE(TAG, "❌ Failed to allocate %d bytes (%s)", (int)size, description);
+    } else if (slot >= 0) {
+        ESP_LOGD(TAG, "✅ Allocated %d bytes at %p (%s) - Slot %d", (int)size, ptr, description, slot);
+    } else if (overflows % TRACK_OVERFLOW_LOG_EVERY == 1) {
+        ESP_LOGW(TAG, "⚠️ Allocation tracking full (%lu records): %lu allocations untracked so far",
+                 (unsigned long)tracker.capacity, (unsigned long)overflows);
+    }
+    heap_trace_emit(ptr ? HEAP_EV_ALLOC : HEAP_EV_FAIL, ptr, size, caps);
     
     return ptr;
 }
 
 void tracked_free(void* ptr, const char* description) {
     if (!ptr) return;
+    int slot = -1;
+    size_t size = 0;
+    bool unknown = false;
     
     if (memory_monitoring_enabled && memory_mutex) {
         if (xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            int slot = find_allocation_by_ptr(ptr);
-            if (slot >= 0) {
-                allocations[slot].is_active = false;
+            const int i = find_index_slot(ptr);
+            if (i >= 0) {
+                slot = tracker.index[i] - 1;
+                const memory_allocation_cold_t* rec = &tracker.records.cold[slot];
+                size = rec->size;
+                
+                // Charged to the allocating task, whoever frees it
+                task_account_t* owner = &task_accounts[rec->owner];
+                owner->live_blocks--;
+                owner->live_bytes -= size;
+                if (rec->internal) owner->internal_bytes -= size;
+                index_remove(i);
+                tracker.records.ptr[slot] = NULL;
+                tracker.free_stack[tracker.free_top++] = slot;
+
                 stats.total_deallocations++;
                 stats.current_allocations--;
-                stats.total_bytes_deallocated += allocations[slot].size;
-                
-                ESP_LOGI(TAG, "🗑️ Freed %d bytes at %p (%s) - Slot %d", 
-                         allocations[slot].size, ptr, description, slot);
+                stats.total_bytes_deallocated += size;
+            } else if (tracker.untracked_live > 0) {
+                tracker.untracked_live--;       // most likely one of the overflow allocations
             } else {
-                ESP_LOGW(TAG, "⚠️ Freeing untracked pointer %p (%s)", ptr, description);
+                unknown = true;
             }
             
             xSemaphoreGive(memory_mutex);
         }
     }
+
+    if (slot >= 0) {
+        ESP_LOGD(TAG, "🗑️ Freed %d bytes at %p (%s) - Slot %d", (int)size, ptr, description, slot);
+    } else if (unknown) {
+        ESP_LOGW(TAG, "⚠️ Freeing untracked pointer %p (%s)", ptr, description);
+    }
+    heap_trace_emit(HEAP_EV_FREE, ptr, size, 0);   // before the block can be reused
     
     heap_caps_free(ptr);
 }
 
 // Memory analysis functions
+#if HEAP_INTERPOSE_ENABLED
+// Whole-program heap interposition. The linker redirects malloc/calloc/realloc/
+// free and heap_caps_malloc/calloc/free to the __wrap_ functions below, so WiFi,
+// FreeRTOS objects and newlib allocations are seen too, not only tracked_malloc.
+// Everything is fixed-size and static: the hooks never allocate, run from IRAM
+// and hold one spinlock for an O(1) hash update (safe before the scheduler
+// starts and with the flash cache disabled).
+typedef struct {
+    uint32_t pc;                // caller return address, 0 = unused
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t live_blocks;
+    uint32_t live_bytes;
+    uint32_t peak_live_bytes;
+    uint64_t total_bytes;
+    uint64_t lifetime_ms_sum;   // over freed blocks
+    uint32_t max_lifetime_ms;
+    uint32_t allocs_at_report;  // for the allocation-rate ranking
+    uint64_t bytes_at_report;
+} interpose_site_t;
+
+typedef struct {
+    uint32_t ptr;               // 0 = empty
+    uint32_t size : 24;         // bytes, clamped to 16 MB
+    uint32_t site : 8;
+    uint32_t born_ms;
+} interpose_live_t;
+
+typedef struct {
+    uint32_t calls;
+    uint32_t hook_cycles;       // cycles spent in the hooks, excluding the real allocator
+    uint32_t hook_cycles_max;
+    uint32_t live;
+    uint32_t untracked;         // blocks not recorded because the live table was full
+    uint32_t site_overflows;    // allocations booked to "<other>"
+} interpose_stats_t;
+
+_Static_assert(INTERPOSE_SITES <= 256, "site index is 8 bits");
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+void* __real_heap_caps_malloc(size_t size, uint32_t caps);
+void* __real_heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void __real_heap_caps_free(void* ptr);
+
+static interpose_site_t interpose_sites[INTERPOSE_SITES];
+static interpose_live_t interpose_live[INTERPOSE_LIVE_SLOTS];
+static interpose_stats_t interpose_stats;
+static portMUX_TYPE interpose_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool interpose_enabled = true;
+static uint64_t interpose_last_report_us;
+
+static inline IRAM_ATTR uint32_t interpose_hash(uint32_t key) {
+    return key * 2654435761u;
+}
+
+// Site for pc (caller holds interpose_mux); full table -> site 0
+static inline IRAM_ATTR uint32_t interpose_site_for(uint32_t pc) {
+    const uint32_t mask = INTERPOSE_SITES - 1;
+    uint32_t i = interpose_hash(pc) & mask;
+    for (uint32_t probes = 0; probes < INTERPOSE_SITES; probes++, i = (i + 1) & mask) {
+        if (i == 0) continue;
+        if (interpose_sites[i].pc == pc) return i;
+        if (interpose_sites[i].pc == 0) {
+            interpose_sites[i].pc = pc;
+            return i;
+        }
+    }
+    interpose_stats.site_overflows++;
+    return 0;
+}
+
+static IRAM_ATTR void interpose_record_alloc(void* ptr, size_t size, uint32_t pc) {
+    const uint32_t now_ms = esp_timer_get_time() / 1000;
+    const uint32_t mask = INTERPOSE_LIVE_SLOTS - 1;
+
+    portENTER_CRITICAL_SAFE(&interpose_mux);
+    const uint32_t site = interpose_site_for(pc);
+    interpose_site_t* s = &interpose_sites[site];
+    s->allocs++;
+    s->total_bytes += size;
+    if (interpose_stats.live < INTERPOSE_LIVE_SLOTS * 3 / 4) {
+        uint32_t i = interpose_hash((uint32_t)(uintptr_t)ptr >> 3) & mask;
+        while (interpose_live[i].ptr != 0) i = (i + 1) & mask;
+        interpose_live[i].ptr = (uint32_t)(uintptr_t)ptr;
+        interpose_live[i].size = size < 0xFFFFFF ? size : 0xFFFFFF;
+        interpose_live[i].site = site;
+        interpose_live[i].born_ms = now_ms;
+        interpose_stats.live++;
+        s->live_blocks++;
+        s->live_bytes += interpose_live[i].size;
+        if (s->live_bytes > s->peak_live_bytes) s->peak_live_bytes = s->live_bytes;
+    } else {
+        interpose_stats.untracked++;
+    }
+    portEXIT_CRITICAL_SAFE(&interpose_mux);
+}
+
+// Unknown pointers (allocated before tracking, while the table was full, or
+// already seen by free() before it reached heap_caps_free()) are ignored
+static IRAM_ATTR void interpose_record_free(void* ptr) {
+    const uint32_t now_ms = esp_timer_get_time() / 1000;
+    const uint32_t mask = INTERPOSE_LIVE_SLOTS - 1;
+
+    portENTER_CRITICAL_SAFE(&interpose_mux);
+    uint32_t i = interpose_hash((uint32_t)(uintptr_t)ptr >> 3) & mask;
+    while (interpose_live[i].ptr != 0 && interpose_live[i].ptr != (uint32_t)(uintptr_t)ptr) i = (i + 1) & mask;
+    if (interpose_live[i].ptr != 0) {
+        interpose_site_t* s = &interpose_sites[interpose_live[i].site];
+        const uint32_t lifetime_ms = now_ms - interpose_live[i].born_ms;
+        s->frees++;
+        s->live_blocks--;
+        s->live_bytes -= interpose_live[i].size;
+        s->lifetime_ms_sum += lifetime_ms;
+        if (lifetime_ms > s->max_lifetime_ms) s->max_lifetime_ms = lifetime_ms;
+        interpose_stats.live--;
+
+        // Backward-shift delete, as in index_remove()
+        uint32_t j = i;
+        interpose_live[i].ptr = 0;
+        while (1) {
+            j = (j + 1) & mask;
+            if (interpose_live[j].ptr == 0) break;
+            const uint32_t home = interpose_hash(interpose_live[j].ptr >> 3) & mask;
+            const bool home_between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+            if (home_between) continue;
+            interpose_live[i] = interpose_live[j];
+            interpose_live[j].ptr = 0;
+            i = j;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&interpose_mux);
+}
+
+static inline IRAM_ATTR void interpose_account(uint32_t start_cycles) {
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles;
+    interpose_stats.calls++;            // racy across cores, statistics only
+    interpose_stats.hook_cycles += cycles;
+    if (cycles > interpose_stats.hook_cycles_max) interpose_stats.hook_cycles_max = cycles;
+}
+
+static inline IRAM_ATTR void interpose_after_alloc(void* ptr, size_t size, void* ra) {
+    if (!ptr || !interpose_enabled) return;
+    const uint32_t start = esp_cpu_get_cycle_count();
+    interpose_record_alloc(ptr, size, esp_cpu_process_stack_pc((uint32_t)(uintptr_t)ra));
+    interpose_account(start);
+}
+
+static inline IRAM_ATTR void interpose_before_free(void* ptr) {
+    if (!ptr || !interpose_enabled) return;
+    const uint32_t start = esp_cpu_get_cycle_count();
+    interpose_record_free(ptr);
+    interpose_account(start);
+}
+
+IRAM_ATTR void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    interpose_after_alloc(ptr, size, __builtin_return_address(0));
+    return ptr;
+}
+
+IRAM_ATTR void* __wrap_calloc(size_t n, size_t size) {
+    void* ptr = __real_calloc(n, size);
+    interpose_after_alloc(ptr, n * size, __builtin_return_address(0));
+    return ptr;
+}
+
+IRAM_ATTR void* __wrap_realloc(void* ptr, size_t size) {
+    void* new_ptr = __real_realloc(ptr, size);
+    if (new_ptr || size == 0) {
+        interpose_before_free(ptr);
+        interpose_after_alloc(new_ptr, size, __builtin_return_address(0));
+    }
+    return new_ptr;
+}
+
+IRAM_ATTR void __wrap_free(void* ptr) {
+    interpose_before_free(ptr);
+    __real_free(ptr);
+}
+
+IRAM_ATTR void* __wrap_heap_caps_malloc(size_t size, uint32_t caps) {
+    void* ptr = __real_heap_caps_malloc(size, caps);
+    interpose_after_alloc(ptr, size, __builtin_return_address(0));
+    return ptr;
+}
+
+IRAM_ATTR void* __wrap_heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    void* ptr = __real_heap_caps_calloc(n, size, caps);
+    interpose_after_alloc(ptr, n * size, __builtin_return_address(0));
+    return ptr;
+}
+
+IRAM_ATTR void __wrap_heap_caps_free(void* ptr) {
+    interpose_before_free(ptr);
+    __real_heap_caps_free(ptr);
+}
+
+void heap_interpose_set_enabled(bool enabled) {
+    interpose_enabled = enabled;
+}
+
+// Top-N call sites by live bytes and by allocation rate since the last report
+void heap_interpose_report(void) {
+    static interpose_site_t snap[INTERPOSE_SITES];   // monitor task only
+    static interpose_stats_t snap_stats;
+    uint8_t order[INTERPOSE_SITES];
+    int n = 0;
+
+    portENTER_CRITICAL(&interpose_mux);
+    memcpy(snap, interpose_sites, sizeof(snap));
+    snap_stats = interpose_stats;
+    for (int i = 0; i < INTERPOSE_SITES; i++) {
+        interpose_sites[i].allocs_at_report = interpose_sites[i].allocs;
+        interpose_sites[i].bytes_at_report = interpose_sites[i].total_bytes;
+    }
+    portEXIT_CRITICAL(&interpose_mux);
+
+    const uint64_t now_us = esp_timer_get_time();
+    const float elapsed_s = (now_us - interpose_last_report_us) / 1000000.0f;
+    interpose_last_report_us = now_us;
+
+    for (int i = 0; i < INTERPOSE_SITES; i++) {
+        if (snap[i].allocs > 0) order[n++] = i;
+    }
+
+    ESP_LOGI(TAG, "\n🎯 ═══ HEAP CALL SITES (top %d by live bytes) ═══", INTERPOSE_TOP_N);
+    for (int k = 0; k < n && k < INTERPOSE_TOP_N; k++) {
+        int best = k;   // partial selection sort, n <= 64
+        for (int j = k + 1; j < n; j++) {
+            if (snap[order[j]].live_bytes > snap[order[best]].live_bytes) best = j;
+        }
+        const uint8_t t = order[k]; order[k] = order[best]; order[best] = t;
+        const interpose_site_t* s = &snap[order[k]];
+        if (s->live_bytes == 0) break;
+        ESP_LOGI(TAG, "%s0x%08lx: %6lu B live in %4lu blocks (peak %lu B), %lu allocs, avg life %lu ms",
+                 order[k] == 0 ? "<other> " : "", s->pc, s->live_bytes, s->live_blocks,
+                 s->peak_live_bytes, s->allocs, s->frees ? (uint32_t)(s->lifetime_ms_sum / s->frees) : 0);
+    }
+
+    ESP_LOGI(TAG, "🎯 Top %d by allocation rate (last %.1f s):", INTERPOSE_TOP_N, elapsed_s);
+    for (int k = 0; k < n && k < INTERPOSE_TOP_N; k++) {
+        int best = k;
+        for (int j = k + 1; j < n; j++) {
+            if (snap[order[j]].allocs - snap[order[j]].allocs_at_report >
+                snap[order[best]].allocs - snap[order[best]].allocs_at_report) best = j;
+        }
+        const uint8_t t = order[k]; order[k] = order[best]; order[best] = t;
+        const interpose_site_t* s = &snap[order[k]];
+        const uint32_t recent = s->allocs - s->allocs_at_report;
+        if (recent == 0) break;
+        ESP_LOGI(TAG, "%s0x%08lx: %7.1f allocs/s, %8.0f B/s, max life %lu ms",
+                 order[k] == 0 ? "<other> " : "", s->pc, recent / elapsed_s,
+                 (s->total_bytes - s->bytes_at_report) / elapsed_s, s->max_lifetime_ms);
+    }
+
+    ESP_LOGI(TAG, "Interposer: %lu hook calls, avg %lu cycles (max %lu), live %lu/%d, untracked %lu, site overflow %lu",
+             snap_stats.calls, snap_stats.calls ? snap_stats.hook_cycles / snap_stats.calls : 0,
+             snap_stats.hook_cycles_max, snap_stats.live, INTERPOSE_LIVE_SLOTS * 3 / 4,
+             snap_stats.untracked, snap_stats.site_overflows);
+    ESP_LOGI(TAG, "(resolve PCs: xtensa-esp32-elf-addr2line -pfiaC -e build/heap_management.elf <pc>)");
+}
+#endif // HEAP_INTERPOSE_ENABLED
+
 void analyze_memory_status(void) {
     size_t internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
     size_t internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
@@ -157,10 +1059,10 @@ void analyze_memory_status(void) {
     }
     
     ESP_LOGI(TAG, "\n📊 ═══ MEMORY STATUS ═══");
-    ESP_LOGI(TAG, "Internal RAM Free:    %d bytes", internal_free);
-    ESP_LOGI(TAG, "Largest Free Block:   %d bytes", internal_largest);
-    ESP_LOGI(TAG, "SPIRAM Free:          %d bytes", spiram_free);
-    ESP_LOGI(TAG, "Total Free:           %d bytes", total_free);
+    ESP_LOGI(TAG, "Internal RAM Free:    %d bytes", (int)internal_free);
+    ESP_LOGI(TAG, "Largest Free Block:   %d bytes", (int)internal_largest);
+    ESP_LOGI(TAG, "SPIRAM Free:          %d bytes", (int)spiram_free);
+    ESP_LOGI(TAG, "Total Free:           %d bytes", (int)total_free);
     ESP_LOGI(TAG, "Minimum Ever Free:    %d bytes", esp_get_minimum_free_heap_size());
     ESP_LOGI(TAG, "Internal Fragmentation: %.1f%%", internal_fragmentation * 100);
     
@@ -200,72 +1102,522 @@ void analyze_memory_status(void) {
     ESP_LOGI(TAG, "═══════════════════════════════");
 }
 
+// Memory-pressure shrinker registry
+bool shrinker_register(const char* name, int priority, shrink_count_fn_t count, shrink_fn_t shrink, void* ctx) {
+    if (!shrink_registry.mutex || xSemaphoreTake(shrink_registry.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    
+    bool ok = shrink_registry.count < SHRINKER_MAX;
+    if (ok) {
+        int i = shrink_registry.count++;
+        while (i > 0 && shrink_registry.shrinkers[i - 1].priority > priority) {
+            shrink_registry.shrinkers[i] = shrink_registry.shrinkers[i - 1];
+            i--;
+        }
+        shrink_registry.shrinkers[i] = (shrinker_t){ .name = name, .priority = priority,
+                                                     .count = count, .shrink = shrink, .ctx = ctx };
+        ESP_LOGI(TAG, "🧹 Shrinker registered: %s (priority %d)", name, priority);
+    }
+    
+    xSemaphoreGive(shrink_registry.mutex);
+    return ok;
+}
+
+// Call shrinkers in priority order until target_bytes are reclaimed
+static size_t shrink_memory(size_t target_bytes, bool critical) {
+    size_t reclaimed = 0;
+    if (!shrink_registry.mutex || xSemaphoreTake(shrink_registry.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0;
+    
+    for (int i = 0; i < shrink_registry.count && (critical || reclaimed < target_bytes); i++) {
+        shrinker_t* sh = &shrink_registry.shrinkers[i];
+        if (sh->count && sh->count(sh->ctx) == 0) continue;
+        
+        const uint64_t start = esp_timer_get_time();
+        const size_t got = sh->shrink(target_bytes > reclaimed ? target_bytes - reclaimed : 0, critical, sh->ctx);
+        const uint32_t elapsed_us = esp_timer_get_time() - start;
+        
+        sh->calls++;
+        sh->reclaimed_bytes += got;
+        sh->time_us += elapsed_us;
+        if (elapsed_us > sh->max_time_us) sh->max_time_us = elapsed_us;
+        reclaimed += got;
+        ESP_LOGI(TAG, "🧹 %s: reclaimed %d bytes in %lu μs", sh->name, (int)got, (unsigned long)elapsed_us);
+    }
+    
+    xSemaphoreGive(shrink_registry.mutex);
+    return reclaimed;
+}
+
+// Watermarks with hysteresis: shrinking starts when internal free drops below
+// SHRINK_LOW_WATERMARK and continues until it is back above SHRINK_HIGH_WATERMARK
+void memory_pressure_check(void) {
+    const size_t internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    
+    if (!shrink_registry.under_pressure) {
+        if (internal_free >= SHRINK_LOW_WATERMARK) return;
+        shrink_registry.under_pressure = true;
+        shrink_registry.pressure_events++;
+        ESP_LOGW(TAG, "🧹 Memory pressure: %d bytes free (low watermark %d)", (int)internal_free, SHRINK_LOW_WATERMARK);
+    } else if (internal_free >= SHRINK_HIGH_WATERMARK) {
+        shrink_registry.under_pressure = false;
+        ESP_LOGI(TAG, "🧹 Memory pressure relieved: %d bytes free", (int)internal_free);
+        return;
+    }
+    
+    const bool critical = internal_free < CRITICAL_MEMORY_THRESHOLD;
+    if (critical) shrink_registry.critical_events++;
+    const size_t reclaimed = shrink_memory(SHRINK_HIGH_WATERMARK - internal_free, critical);
+    if (reclaimed > 0) {
+        ESP_LOGI(TAG, "🧹 Reclaimed %d bytes%s, internal free now %d", (int)reclaimed,
+                 critical ? " (critical)" : "", (int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    }
+}
+
+void print_shrinker_statistics(void) {
+    if (!shrink_registry.mutex || xSemaphoreTake(shrink_registry.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    
+    ESP_LOGI(TAG, "\n🧹 ═══ SHRINKERS (%lu pressure, %lu critical events) ═══",
+             (unsigned long)shrink_registry.pressure_events, (unsigned long)shrink_registry.critical_events);
+    for (int i = 0; i < shrink_registry.count; i++) {
+        const shrinker_t* sh = &shrink_registry.shrinkers[i];
+        ESP_LOGI(TAG, "%-14s prio %d: %3lu calls, %6d B reclaimed, %5llu μs total (max %lu), ~%d B reclaimable",
+                 sh->name, sh->priority, (unsigned long)sh->calls, (int)sh->reclaimed_bytes,
+                 (unsigned long long)sh->time_us, (unsigned long)sh->max_time_us,
+                 sh->count ? (int)sh->count(sh->ctx) : 0);
+    }
+    
+    xSemaphoreGive(shrink_registry.mutex);
+}
+
+// Relocatable buffers
+bool movable_arena_init(movable_arena_t* arena, const char* name, size_t size, bool compaction) {
+    memset(arena, 0, sizeof(*arena));
+    arena->name = name;
+    arena->region_size = size & ~(MOVABLE_ALIGN - 1);
+    arena->region = heap_caps_malloc(arena->region_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    arena->mutex = xSemaphoreCreateMutex();
+    arena->compaction = compaction;
+    if (!arena->region || !arena->mutex || movable_arena_count >= MOVABLE_ARENA_MAX) {
+        ESP_LOGE(TAG, "Failed to create movable arena %s", name);
+        return false;
+    }
+    movable_arenas[movable_arena_count++] = arena;
+    return true;
+}
+
+static movable_slot_t* movable_resolve(movable_arena_t* arena, movable_handle_t handle) {
+    const uint32_t index = (handle & 0xFFFF) - 1;
+    if (handle == MOVABLE_HANDLE_NULL || index >= MOVABLE_HANDLES) return NULL;
+    movable_slot_t* slot = &arena->slots[index];
+    return (slot->size && slot->generation == handle >> 16) ? slot : NULL;
+}
+
+size_t movable_compact_step(movable_arena_t* arena, size_t budget_bytes);
+
+// First fit over the gaps between blocks (caller holds the mutex)
+static movable_handle_t movable_alloc_locked(movable_arena_t* arena, size_t size) {
+    movable_handle_t handle = MOVABLE_HANDLE_NULL;
+    int index = 0;
+    while (index < MOVABLE_HANDLES && arena->slots[index].size) index++;
+    
+    uint32_t prev_end = 0;
+    int pos = 0;
+    for (; pos <= arena->count && index < MOVABLE_HANDLES; pos++) {
+        const uint32_t next = pos < arena->count ? arena->slots[arena->order[pos]].offset : arena->region_size;
+        if (next - prev_end >= size) {
+            movable_slot_t* slot = &arena->slots[index];
+            slot->offset = prev_end;
+            slot->size = size;
+            slot->pins = 0;
+            if (++slot->generation == 0) slot->generation = 1;
+            memmove(&arena->order[pos + 1], &arena->order[pos], (arena->count - pos) * sizeof(arena->order[0]));
+            arena->order[pos] = index;
+            arena->count++;
+            handle = ((uint32_t)slot->generation << 16) | (index + 1);
+            break;
+        }
+        if (pos < arena->count) prev_end = next + arena->slots[arena->order[pos]].size;
+    }
+    return handle;
+}
+
+// MOVABLE_HANDLE_NULL when nothing fits; a compacting arena first slides
+// everything down and retries, so only a real lack of space fails
+movable_handle_t movable_alloc(movable_arena_t* arena, size_t size) {
+    size = (size + MOVABLE_ALIGN - 1) & ~(MOVABLE_ALIGN - 1);
+    if (size == 0 || xSemaphoreTake(arena->mutex, pdMS_TO_TICKS(100)) != pdTRUE) return MOVABLE_HANDLE_NULL;
+    movable_handle_t handle = movable_alloc_locked(arena, size);
+    xSemaphoreGive(arena->mutex);
+    
+    if (handle == MOVABLE_HANDLE_NULL && arena->compaction &&
+        movable_compact_step(arena, arena->region_size) > 0 &&
+        xSemaphoreTake(arena->mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        handle = movable_alloc_locked(arena, size);
+        xSemaphoreGive(arena->mutex);
+    }
+    if (handle == MOVABLE_HANDLE_NULL) arena->alloc_failures++;
+    return handle;
+}
+
+bool movable_free(movable_arena_t* arena, movable_handle_t handle) {
+    if (xSemaphoreTake(arena->mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+    movable_slot_t* slot = movable_resolve(arena, handle);
+    const bool ok = slot && slot->pins == 0;
+    if (ok) {
+        const uint16_t index = slot - arena->slots;
+        int pos = 0;
+        while (arena->order[pos] != index) pos++;
+        memmove(&arena->order[pos], &arena->order[pos + 1], (arena->count - pos - 1) * sizeof(arena->order[0]));
+        arena->count--;
+        slot->size = 0;
+    }
+    xSemaphoreGive(arena->mutex);
+    return ok;
+}
+
+// Pointer valid until the matching movable_unpin(); NULL for a stale handle
+void* movable_pin(movable_arena_t* arena, movable_handle_t handle) {
+    void* ptr = NULL;
+    if (xSemaphoreTake(arena->mutex, pdMS_TO_TICKS(100)) != pdTRUE) return NULL;
+    movable_slot_t* slot = movable_resolve(arena, handle);
+    if (slot) {
+        slot->pins++;
+        ptr = arena->region + slot->offset;
+    }
+    xSemaphoreGive(arena->mutex);
+    return ptr;
+}
+
+void movable_unpin(movable_arena_t* arena, movable_handle_t handle) {
+    if (xSemaphoreTake(arena->mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    movable_slot_t* slot = movable_resolve(arena, handle);
+    if (slot && slot->pins > 0) slot->pins--;
+    xSemaphoreGive(arena->mutex);
+}
+
+size_t movable_largest_free(movable_arena_t* arena, size_t* total_free) {
+    size_t largest = 0, total = 0;
+    if (xSemaphoreTake(arena->mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        uint32_t prev_end = 0;
+        for (int pos = 0; pos <= arena->count; pos++) {
+            const movable_slot_t* slot = pos < arena->count ? &arena->slots[arena->order[pos]] : NULL;
+            const uint32_t next = slot ? slot->offset : arena->region_size;
+            const size_t gap = next - prev_end;
+            total += gap;
+            if (gap > largest) largest = gap;
+            if (slot) prev_end = slot->offset + slot->size;
+        }
+        xSemaphoreGive(arena->mutex);
+    }
+    if (total_free) *total_free = total;
+    return largest;
+}
+
+// Slide unpinned blocks down into the gaps, one block per lock hold, until
+// budget_bytes have moved or nothing can move. Pinned blocks stay put and the
+// blocks after them slide up against their end. Returns bytes moved.
+size_t movable_compact_step(movable_arena_t* arena, size_t budget_bytes) {
+    size_t moved = 0;
+    while (moved < budget_bytes) {
+        if (xSemaphoreTake(arena->mutex, pdMS_TO_TICKS(100)) != pdTRUE) break;
+        
+        uint32_t cursor = 0;
+        movable_slot_t* victim = NULL;
+        for (int pos = 0; pos < arena->count; pos++) {
+            movable_slot_t* slot = &arena->slots[arena->order[pos]];
+            if (slot->pins == 0 && slot->offset > cursor) {
+                victim = slot;
+                break;
+            }
+            cursor = slot->offset + slot->size;
+        }
+        if (victim) {
+            const uint64_t start = esp_timer_get_time();
+            memmove(arena->region + cursor, arena->region + victim->offset, victim->size);
+            victim->offset = cursor;        // order[] is unchanged: the block stays between its neighbours
+            const uint32_t pause_us = esp_timer_get_time() - start;
+            if (pause_us > arena->max_pause_us) arena->max_pause_us = pause_us;
+            arena->moves++;
+            arena->bytes_moved += victim->size;
+            moved += victim->size;
+        }
+        
+        xSemaphoreGive(arena->mutex);
+        if (!victim) break;
+    }
+    return moved;
+}
+
+// Background compactor: steps every arena that has compaction enabled and is fragmented
+void movable_compactor_task(void *pvParameters) {
+    ESP_LOGI(TAG, "🧲 Heap compactor started");
+    
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(COMPACT_CHECK_MS));
+        for (int i = 0; i < movable_arena_count; i++) {
+            movable_arena_t* arena = movable_arenas[i];
+            if (!arena->compaction) continue;
+            size_t total_free;
+            const size_t largest = movable_largest_free(arena, &total_free);
+            if (total_free > 0 && 1.0f - (float)largest / total_free > FRAGMENTATION_THRESHOLD) {
+                movable_compact_step(arena, COMPACT_STEP_BYTES);
+            }
+        }
+    }
+}
+
 void print_allocation_summary(void) {
     if (!memory_mutex) return;
     
     if (xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
         ESP_LOGI(TAG, "\n📈 ═══ ALLOCATION STATISTICS ═══");
-        ESP_LOGI(TAG, "Total Allocations:    %lu", stats.total_allocations);
-        ESP_LOGI(TAG, "Total Deallocations:  %lu", stats.total_deallocations);
-        ESP_LOGI(TAG, "Current Allocations:  %lu", stats.current_allocations);
-        ESP_LOGI(TAG, "Total Allocated:      %llu bytes", stats.total_bytes_allocated);
-        ESP_LOGI(TAG, "Total Deallocated:    %llu bytes", stats.total_bytes_deallocated);
-        ESP_LOGI(TAG, "Peak Usage:           %llu bytes", stats.peak_usage);
-        ESP_LOGI(TAG, "Allocation Failures:  %lu", stats.allocation_failures);
-        ESP_LOGI(TAG, "Fragmentation Events: %lu", stats.fragmentation_events);
-        ESP_LOGI(TAG, "Low Memory Events:    %lu", stats.low_memory_events);
-        
+        ESP_LOGI(TAG, "Total Allocations:    %lu", (unsigned long)stats.total_allocations);
+        ESP_LOGI(TAG, "Total Deallocations:  %lu", (unsigned long)stats.total_deallocations);
+        ESP_LOGI(TAG, "Current Allocations:  %lu", (unsigned long)stats.current_allocations);
+        ESP_LOGI(TAG, "Total Allocated:      %llu bytes", (unsigned long long)stats.total_bytes_allocated);
+        ESP_LOGI(TAG, "Total Deallocated:    %llu bytes", (unsigned long long)stats.total_bytes_deallocated);
+        ESP_LOGI(TAG, "Peak Usage:           %llu bytes", (unsigned long long)stats.peak_usage);
+        ESP_LOGI(TAG, "Allocation Failures:  %lu", (unsigned long)stats.allocation_failures);
+        ESP_LOGI(TAG, "Fragmentation Events: %lu", (unsigned long)stats.fragmentation_events);
+        ESP_LOGI(TAG, "Low Memory Events:    %lu", (unsigned long)stats.low_memory_events);
+        ESP_LOGI(TAG, "Tracker:              %lu/%lu records, %lu untracked (overflow) live",
+                 (unsigned long)stats.current_allocations, (unsigned long)tracker.capacity,
+                 (unsigned long)tracker.untracked_live);
+        ESP_LOGI(TAG, "Heap Trace:           %lu events, %lu dropped",
+                 (unsigned long)heap_trace.emitted, (unsigned long)heap_trace.dropped);
         if (stats.current_allocations > 0) {
             ESP_LOGI(TAG, "\n🔍 ═══ ACTIVE ALLOCATIONS ═══");
-            for (int i = 0; i < MAX_ALLOCATIONS; i++) {
-                if (allocations[i].is_active) {
-                    uint64_t age_ms = (esp_timer_get_time() - allocations[i].timestamp) / 1000;
-                    ESP_LOGI(TAG, "Slot %d: %d bytes at %p (%s) - Age: %llu ms",
-                             i, allocations[i].size, allocations[i].ptr,
-                             allocations[i].description, age_ms);
+            int shown = 0;
+            void* const* live = track_records_col_ptr(&tracker.records);
+            for (uint32_t i = 0; i < tracker.capacity && shown < SUMMARY_MAX_LINES; i++) {
+                if (live[i]) {
+                    const memory_allocation_cold_t* rec = &tracker.records.cold[i];
+                    uint64_t age_ms = (esp_timer_get_time() - rec->timestamp) / 1000;
+                    ESP_LOGI(TAG, "Slot %lu: %d bytes at %p (%s) - Age: %llu ms",
+                             (unsigned long)i, (int)rec->size, live[i], rec->description,
+                             (unsigned long long)age_ms);
+                    shown++;
                 }
             }
+            if (stats.current_allocations > (uint32_t)shown) {
+                ESP_LOGI(TAG, "... and %lu more", (unsigned long)(stats.current_allocations - shown));
+            }
         }
         
         xSemaphoreGive(memory_mutex);
     }
 }
 
+// Start a new leak-detection epoch (one workload cycle); O(1) under memory_mutex
+void leak_epoch_mark(void) {
+    if (xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        leak_epochs.current++;
+        leak_epochs.started_us[leak_epochs.current % LEAK_EPOCH_HISTORY] = esp_timer_get_time();
+        xSemaphoreGive(memory_mutex);
+    }
+}
+
+// Blocks born in the last LEAK_WINDOW_EPOCHS epochs that have survived
+// LEAK_SURVIVE_EPOCHS later ones, grouped by call site. A site that leaves
+// survivors in several epochs is leaking; a buffer allocated once and kept
+// (a cache, a frame buffer) survives in a single epoch and then leaves the
+// window, so it is not reported. The tracker is walked in LEAK_SCAN_CHUNK
+// slices so memory_mutex is never held for a full walk. Returns the number
+// of leaking sites.
+int leak_epoch_report(void) {
+    static leak_group_t groups[LEAK_GROUPS];    // monitor task only
+    int group_count = 0;
+    int leaking_sites = 0;
+    const uint32_t cur = __atomic_load_n(&leak_epochs.current, __ATOMIC_RELAXED);
+
+    ESP_LOGI(TAG, "\n🔍 ═══ MEMORY LEAK DETECTION (epoch %lu) ═══", (unsigned long)cur);
+    if (cur <= LEAK_SURVIVE_EPOCHS) {
+        ESP_LOGI(TAG, "Warming up: first report after %d epochs", LEAK_SURVIVE_EPOCHS + 1);
+        return 0;
+    }
+    const uint32_t newest = cur - LEAK_SURVIVE_EPOCHS - 1;     // last birth epoch examined
+    const uint32_t oldest = newest + 1 > LEAK_WINDOW_EPOCHS ? newest + 1 - LEAK_WINDOW_EPOCHS : 0;
+    memset(groups, 0, sizeof(groups));
+    void* const* live = track_records_col_ptr(&tracker.records);
+    const uint32_t* epoch = track_records_col_epoch(&tracker.records);
+
+    for (uint32_t base = 0; base < tracker.capacity; base += LEAK_SCAN_CHUNK) {
+        if (xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+        const uint32_t end = base + LEAK_SCAN_CHUNK < tracker.capacity ? base + LEAK_SCAN_CHUNK : tracker.capacity;
+        for (uint32_t i = base; i < end; i++) {
+            if (!live[i] || epoch[i] < oldest || epoch[i] > newest) continue;
+            const memory_allocation_cold_t* rec = &tracker.records.cold[i];
+
+            int g = 0;
+            while (g < group_count && groups[g].site != rec->site) g++;
+            if (g == group_count) {
+                if (group_count < LEAK_GROUPS) {
+                    group_count++;
+                    groups[g].site = rec->site;
+                    strncpy(groups[g].label, g < LEAK_GROUPS - 1 ? rec->description : "<other>",
+                            sizeof(groups[g].label) - 1);
+                } else {
+                    g = LEAK_GROUPS - 1;
+                }
+            }
+            groups[g].count++;
+            groups[g].bytes += rec->size;
+            groups[g].epoch_mask |= 1u << (epoch[i] - oldest);
+        }
+        xSemaphoreGive(memory_mutex);
+    }
+
+    // Leak rate over the birth window [oldest, newest]
+    const uint64_t window_us = leak_epochs.started_us[(newest + 1) % LEAK_EPOCH_HISTORY] -
+                               leak_epochs.started_us[oldest % LEAK_EPOCH_HISTORY];
+    const float window_min = window_us / 60000000.0f;
+    int long_lived = 0;
+    size_t long_lived_bytes = 0;
+
+    for (int g = 0; g < group_count; g++) {
+        const int epochs_hit = __builtin_popcount(groups[g].epoch_mask);
+        if (epochs_hit < LEAK_MIN_RECURRING) {
+            long_lived += groups[g].count;
+            long_lived_bytes += groups[g].bytes;
+            continue;
+        }
+        leaking_sites++;
+        ESP_LOGW(TAG, "LEAK: %-15s @%p: %lu blocks, %d bytes survived %d+ epochs, "
+                 "in %d/%lu epochs, ~%.0f B/min",
+                 groups[g].label, groups[g].site, (unsigned long)groups[g].count, (int)groups[g].bytes,
+                 LEAK_SURVIVE_EPOCHS, epochs_hit, (unsigned long)(newest - oldest + 1),
+                 window_min > 0 ? groups[g].bytes / window_min : 0.0f);
+    }
+
+    if (long_lived > 0) {
+        ESP_LOGI(TAG, "Long-lived (single epoch, not leaks): %d blocks, %d bytes", long_lived, (int)long_lived_bytes);
+    }
+    if (leaking_sites == 0) {
+        ESP_LOGI(TAG, "No memory leaks detected (births in epochs %lu-%lu)", (unsigned long)oldest, (unsigned long)newest);
+    }
+    return leaking_sites;
+}
+
 void detect_memory_leaks(void) {
     if (!memory_mutex) return;
     
-    if (xSemaphoreTake(memory_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        uint64_t current_time = esp_timer_get_time();
-        int leak_count = 0;
-        size_t leaked_bytes = 0;
-        
-        ESP_LOGI(TAG, "\n🔍 ═══ MEMORY LEAK DETECTION ═══");
-        
-        for (int i = 0; i < MAX_ALLOCATIONS; i++) {
-            if (allocations[i].is_active) {
-                uint64_t age_ms = (current_time - allocations[i].timestamp) / 1000;
-                
-                // Consider allocations older than 30 seconds as potential leaks
-                if (age_ms > 30000) {
-                    ESP_LOGW(TAG, "POTENTIAL LEAK: %d bytes at %p (%s) - Age: %llu ms",
-                             allocations[i].size, allocations[i].ptr,
-                             allocations[i].description, age_ms);
-                    leak_count++;
-                    leaked_bytes += allocations[i].size;
-                }
-            }
+    leak_epoch_mark();
+    const int leaking_sites = leak_epoch_report();
+    gpio_set_level(LED_MEMORY_ERROR, leaking_sites > 0);
+}
+
+// Tracked vs untracked malloc+free cost as the number of live tracked allocations grows
+void benchmark_tracking_cost(void) {
+    static const uint32_t levels[] = { 0, 100, 1000, 5000, 10000 };
+    void* live_head = NULL;     // live blocks form a list through their first word
+    uint32_t live = 0;
+
+    ESP_LOGI(TAG, "\n⏱️ ═══ TRACKING COST vs LIVE ALLOCATIONS ═══");
+    ESP_LOGI(TAG, "Tracker capacity: %lu records, %d-byte blocks, %d pairs per level",
+             (unsigned long)tracker.capacity, TRACK_BENCH_BLOCK_SIZE, TRACK_BENCH_PAIRS);
+    esp_log_level_set(TAG, ESP_LOG_WARN);   // silence per-allocation logs while measuring
+
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        bool truncated = false;
+        while (live < levels[l]) {
+            if (heap_caps_get_free_size(MALLOC_CAP_DEFAULT) < LOW_MEMORY_THRESHOLD) { truncated = true; break; }
+            void** block = tracked_malloc(TRACK_BENCH_BLOCK_SIZE, MALLOC_CAP_DEFAULT, "BenchLive");
+            if (!block) { truncated = true; break; }
+            *block = live_head;
+            live_head = block;
+            live++;
         }
-        
-        if (leak_count > 0) {
-            ESP_LOGW(TAG, "Found %d potential leaks totaling %d bytes", leak_count, leaked_bytes);
-            gpio_set_level(LED_MEMORY_ERROR, 1);
-        } else {
-            ESP_LOGI(TAG, "No memory leaks detected");
-            gpio_set_level(LED_MEMORY_ERROR, 0);
+
+        uint64_t start = esp_timer_get_time();
+        for (int i = 0; i < TRACK_BENCH_PAIRS; i++) {
+            void* p = heap_caps_malloc(TRACK_BENCH_BLOCK_SIZE, MALLOC_CAP_DEFAULT);
+            heap_caps_free(p);
+        }
+        const uint64_t untracked_us = esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (int i = 0; i < TRACK_BENCH_PAIRS; i++) {
+            void* p = tracked_malloc(TRACK_BENCH_BLOCK_SIZE, MALLOC_CAP_DEFAULT, "Bench");
+            tracked_free(p, "Bench");
+        }
+        const uint64_t tracked_us = esp_timer_get_time() - start;
+
+        ESP_LOGW(TAG, "Live %5lu%s: untracked %.2f μs, tracked %.2f μs per malloc+free (+%.2f μs)",
+                 (unsigned long)live, live > tracker.capacity ? " (over capacity)" : "",
+                 (float)untracked_us / TRACK_BENCH_PAIRS, (float)tracked_us / TRACK_BENCH_PAIRS,
+                 (float)((int64_t)tracked_us - (int64_t)untracked_us) / TRACK_BENCH_PAIRS);
+        if (truncated) {
+            ESP_LOGW(TAG, "Stopped at %lu live allocations (heap limit)", (unsigned long)live);
+            break;
         }
-        
-        xSemaphoreGive(memory_mutex);
     }
+
+    while (live_head) {
+        void* next = *(void**)live_head;
+        tracked_free(live_head, "BenchLive");
+        live_head = next;
+    }
+    esp_log_level_set(TAG, ESP_LOG_INFO);
+    ESP_LOGI(TAG, "═══════════════════════════════");
+}
+
+// Leak-scan filter (live, birth epoch in window) over TRACK_LAYOUT_ROWS records
+// stored as the old array of structs and as the tracker's SoA table
+void benchmark_tracker_layout(void) {
+    const size_t soa_bytes = track_records_bytes(TRACK_LAYOUT_ROWS);
+    memory_allocation_t* aos = heap_caps_calloc(TRACK_LAYOUT_ROWS, sizeof(memory_allocation_t), MALLOC_CAP_DEFAULT);
+    void* storage = heap_caps_aligned_alloc(SOA_ALIGN, soa_bytes, MALLOC_CAP_DEFAULT);
+    if (!aos || !storage) {
+        ESP_LOGW(TAG, "Tracker layout benchmark skipped (no memory)");
+        heap_caps_free(aos);
+        heap_caps_free(storage);
+        return;
+    }
+    track_records_t soa;
+    track_records_bind(&soa, storage, TRACK_LAYOUT_ROWS);
+
+    // 3/4 of the records live, births spread over 32 epochs; the window holds 6
+    for (uint32_t i = 0; i < TRACK_LAYOUT_ROWS; i++) {
+        void* ptr = (esp_random() & 3) ? (void*)(uintptr_t)(0x3FFB0000 + i * 16) : NULL;
+        const uint32_t epoch = esp_random() % 32;
+        const size_t size = 16 + esp_random() % 256;
+        aos[i].ptr = soa.ptr[i] = ptr;
+        aos[i].epoch = soa.epoch[i] = epoch;
+        aos[i].size = soa.cold[i].size = size;
+    }
+    const uint32_t oldest = 20, newest = 25;
+
+    volatile uint32_t sink = 0;
+    uint64_t start = esp_timer_get_time();
+    for (int r = 0; r < TRACK_LAYOUT_SCANS; r++) {
+        size_t bytes = 0;
+        for (uint32_t i = 0; i < TRACK_LAYOUT_ROWS; i++) {
+            const memory_allocation_t* rec = &aos[i];
+            if (!rec->ptr || rec->epoch < oldest || rec->epoch > newest) continue;
+            bytes += rec->size;
+        }
+        sink += bytes;
+    }
+    const uint64_t aos_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int r = 0; r < TRACK_LAYOUT_SCANS; r++) {
+        void* const* live = track_records_col_ptr(&soa);
+        const uint32_t* epoch = track_records_col_epoch(&soa);
+        size_t bytes = 0;
+        for (uint32_t i = 0; i < TRACK_LAYOUT_ROWS; i++) {
+            if (!live[i] || epoch[i] < oldest || epoch[i] > newest) continue;
+            bytes += soa.cold[i].size;
+        }
+        sink += bytes;
+    }
+    const uint64_t soa_us = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "📐 Tracker leak scan (%d records): AoS %.1f μs (%d B/row) → SoA %.1f μs (%d B/row hot)",
+             TRACK_LAYOUT_ROWS, (float)aos_us / TRACK_LAYOUT_SCANS, (int)sizeof(memory_allocation_t),
+             (float)soa_us / TRACK_LAYOUT_SCANS, (int)(sizeof(void*) + sizeof(uint32_t)));
+
+    heap_caps_free(aos);
+    heap_caps_free(storage);
 }
 
 // Test tasks
@@ -289,7 +1641,7 @@ void memory_stress_test_task(void *pvParameters) {
                 // Write some data to test memory
                 memset(test_ptrs[allocation_count], 0xAA, size);
                 allocation_count++;
-                ESP_LOGI(TAG, "🔧 Stress test: allocated %d bytes (%d/20)", size, allocation_count);
+                ESP_LOGI(TAG, "🔧 Stress test: allocated %d bytes (%d/20)", (int)size, allocation_count);
             }
             
         } else if (action == 1 && allocation_count > 0) {
@@ -364,7 +1716,7 @@ void large_allocation_test_task(void *pvParameters) {
         // Try to allocate large chunks
         size_t large_size = 50000 + (esp_random() % 100000); // 50KB-150KB
         
-        ESP_LOGI(TAG, "🐘 Attempting large allocation: %d bytes", large_size);
+        ESP_LOGI(TAG, "🐘 Attempting large allocation: %d bytes", (int)large_size);
         
         // Try internal RAM first, then SPIRAM
         void* large_ptr = tracked_malloc(large_size, MALLOC_CAP_INTERNAL, "LargeInternal");
@@ -383,7 +1735,7 @@ void large_allocation_test_task(void *pvParameters) {
             uint64_t end_time = esp_timer_get_time();
             
             uint32_t access_time_ms = (end_time - start_time) / 1000;
-            ESP_LOGI(TAG, "🐘 Memory access time: %lu ms", access_time_ms);
+            ESP_LOGI(TAG, "🐘 Memory access time: %lu ms", (unsigned long)access_time_ms);
             
             // Keep allocation for a while
             vTaskDelay(pdMS_TO_TICKS(10000)); // 10 seconds
@@ -399,6 +1751,282 @@ void large_allocation_test_task(void *pvParameters) {
     }
 }
 
+// Slow leak next to one long-lived buffer: the epoch report flags the
+// first and not the second
+void leak_demo_task(void *pvParameters) {
+    ESP_LOGI(TAG, "💧 Leak demo started");
+    
+    void* blob = tracked_malloc(LEAK_DEMO_BLOB_SIZE, MALLOC_CAP_DEFAULT, "LongLivedBlob");
+    if (blob) memset(blob, 0, LEAK_DEMO_BLOB_SIZE);
+    void* leaked = NULL;    // blocks chained through their first word
+    int leaked_count = 0;
+    
+    while (1) {
+        void** block = tracked_malloc(LEAK_DEMO_BLOCK_SIZE, MALLOC_CAP_DEFAULT, "SlowLeak");
+        if (block) {
+            *block = leaked;
+            leaked = block;
+            leaked_count++;
+        }
+        
+        if (leaked_count >= LEAK_DEMO_MAX_BLOCKS) {
+            ESP_LOGI(TAG, "💧 Leak demo: releasing %d leaked blocks", leaked_count);
+            while (leaked) {
+                void* next = *(void**)leaked;
+                tracked_free(leaked, "SlowLeak");
+                leaked = next;
+            }
+            leaked_count = 0;
+        }
+        
+        vTaskDelay(pdMS_TO_TICKS(3000));
+    }
+}
+
+// Demo subsystems with shrink callbacks: a cache of recent readings and a log ring
+typedef struct {
+    void* entries[READING_CACHE_ENTRIES];   // FIFO, entries[head] is the oldest
+    int head;
+    int count;
+    SemaphoreHandle_t mutex;
+} reading_cache_t;
+
+typedef struct {
+    char* lines;
+    int capacity;
+    int next;
+    uint32_t written;
+    SemaphoreHandle_t mutex;
+} event_log_t;
+
+static reading_cache_t reading_cache;
+static event_log_t event_log;
+
+static size_t reading_cache_count(void* ctx) {
+    return __atomic_load_n(&reading_cache.count, __ATOMIC_RELAXED) * READING_CACHE_ENTRY_SIZE;
+}
+
+static size_t reading_cache_shrink(size_t target_bytes, bool critical, void* ctx) {
+    size_t freed = 0;
+    if (xSemaphoreTake(reading_cache.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0;
+    while (reading_cache.count > 0 && (critical || freed < target_bytes)) {
+        tracked_free(reading_cache.entries[reading_cache.head], "ReadingCache");
+        reading_cache.head = (reading_cache.head + 1) % READING_CACHE_ENTRIES;
+        reading_cache.count--;
+        freed += READING_CACHE_ENTRY_SIZE;
+    }
+    xSemaphoreGive(reading_cache.mutex);
+    return freed;
+}
+
+static void reading_cache_put(void) {
+    if (shrink_registry.under_pressure) return;     // don't refill what the shrinker just dropped
+    void* entry = tracked_malloc(READING_CACHE_ENTRY_SIZE, MALLOC_CAP_INTERNAL, "ReadingCache");
+    if (!entry) return;
+    memset(entry, esp_random() & 0xFF, READING_CACHE_ENTRY_SIZE);
+    if (xSemaphoreTake(reading_cache.mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        tracked_free(entry, "ReadingCache");
+        return;
+    }
+    if (reading_cache.count == READING_CACHE_ENTRIES) {     // full: replace the oldest
+        tracked_free(reading_cache.entries[reading_cache.head], "ReadingCache");
+        reading_cache.head = (reading_cache.head + 1) % READING_CACHE_ENTRIES;
+        reading_cache.count--;
+    }
+    reading_cache.entries[(reading_cache.head + reading_cache.count) % READING_CACHE_ENTRIES] = entry;
+    reading_cache.count++;
+    xSemaphoreGive(reading_cache.mutex);
+}
+
+// Reallocate the log ring keeping the newest lines; caller holds event_log.mutex
+static bool event_log_resize_locked(int capacity) {
+    char* lines = tracked_malloc(capacity * EVENT_LOG_LINE_SIZE, MALLOC_CAP_INTERNAL, "EventLog");
+    if (!lines) return false;
+    memset(lines, 0, capacity * EVENT_LOG_LINE_SIZE);
+    // Keep at most what the old ring holds, or growing would read past its start
+    const int old_capacity = event_log.lines ? event_log.capacity : 0;
+    int kept = event_log.written < (uint32_t)capacity ? (int)event_log.written : capacity;
+    if (kept > old_capacity) kept = old_capacity;
+    for (int i = 0; i < kept; i++) {
+        const int src = ((event_log.next - kept + i) % old_capacity + old_capacity) % old_capacity;
+        memcpy(lines + i * EVENT_LOG_LINE_SIZE, event_log.lines + src * EVENT_LOG_LINE_SIZE, EVENT_LOG_LINE_SIZE);
+    }
+    if (event_log.lines) tracked_free(event_log.lines, "EventLog");
+    event_log.lines = lines;
+    event_log.capacity = capacity;
+    event_log.next = kept % capacity;
+    event_log.written = kept;
+    return true;
+}
+
+static size_t event_log_count(void* ctx) {
+    const int capacity = __atomic_load_n(&event_log.capacity, __ATOMIC_RELAXED);
+    return capacity > EVENT_LOG_MIN_LINES ? (capacity - EVENT_LOG_MIN_LINES) * EVENT_LOG_LINE_SIZE : 0;
+}
+
+static size_t event_log_shrink(size_t target_bytes, bool critical, void* ctx) {
+    size_t freed = 0;
+    if (xSemaphoreTake(event_log.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0;
+    const int capacity = critical ? EVENT_LOG_MIN_LINES : event_log.capacity / 2;
+    if (capacity >= EVENT_LOG_MIN_LINES && capacity < event_log.capacity) {
+        const int old_capacity = event_log.capacity;
+        if (event_log_resize_locked(capacity)) {
+            freed = (old_capacity - capacity) * EVENT_LOG_LINE_SIZE;
+        }
+    }
+    xSemaphoreGive(event_log.mutex);
+    return freed;
+}
+
+static void event_log_append(const char* line) {
+    if (xSemaphoreTake(event_log.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    // Grow back to full size once the pressure is gone
+    if (!shrink_registry.under_pressure && event_log.capacity < EVENT_LOG_LINES) {
+        event_log_resize_locked(event_log.capacity * 2 <= EVENT_LOG_LINES ? event_log.capacity * 2 : EVENT_LOG_LINES);
+    }
+    // Slots are reused, so always terminate (strncpy would leave a long line unterminated)
+    snprintf(event_log.lines + event_log.next * EVENT_LOG_LINE_SIZE, EVENT_LOG_LINE_SIZE, "%s", line);
+    event_log.next = (event_log.next + 1) % event_log.capacity;
+    event_log.written++;
+    xSemaphoreGive(event_log.mutex);
+}
+
+// Watermark monitor plus the demo cache/log producers
+void memory_pressure_task(void *pvParameters) {
+    ESP_LOGI(TAG, "🧹 Memory pressure monitor started");
+    
+    reading_cache.mutex = xSemaphoreCreateMutex();
+    event_log.mutex = xSemaphoreCreateMutex();
+    if (reading_cache.mutex && event_log.mutex &&
+        xSemaphoreTake(event_log.mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        event_log_resize_locked(EVENT_LOG_LINES);
+        xSemaphoreGive(event_log.mutex);
+    }
+    if (!event_log.lines) {
+        ESP_LOGE(TAG, "Failed to set up pressure demo subsystems");
+        vTaskDelete(NULL);
+        return;
+    }
+    shrinker_register("ReadingCache", 0, reading_cache_count, reading_cache_shrink, NULL);
+    shrinker_register("EventLog", 1, event_log_count, event_log_shrink, NULL);
+    
+    uint32_t tick = 0;
+    while (1) {
+        reading_cache_put();
+        char line[EVENT_LOG_LINE_SIZE];
+        snprintf(line, sizeof(line), "t=%llu ms free=%d", (unsigned long long)(esp_timer_get_time() / 1000),
+                 (int)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+        event_log_append(line);
+        
+        memory_pressure_check();
+        if (++tick % 20 == 0) print_shrinker_statistics();  // every ~10 s
+        vTaskDelay(pdMS_TO_TICKS(SHRINK_CHECK_MS));
+    }
+}
+
+// Keeps allocating internal RAM and never frees on its own; its quota makes
+// the allocations fail once it holds RUNAWAY_QUOTA bytes
+void runaway_task(void *pvParameters) {
+    ESP_LOGI(TAG, "🏃 Runaway task started (quota %d bytes)", RUNAWAY_QUOTA);
+    
+    void* held = NULL;      // blocks chained through their first word
+    uint32_t refused = 0;
+    
+    while (1) {
+        void** block = tracked_malloc(RUNAWAY_BLOCK_SIZE, MALLOC_CAP_INTERNAL, "Runaway");
+        if (block) {
+            *block = held;
+            held = block;
+        } else if (++refused % 100 == 0) {
+            // Drop everything now and then so the demo keeps cycling
+            while (held) {
+                void* next = *(void**)held;
+                tracked_free(held, "Runaway");
+                held = next;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(200));
+    }
+}
+
+// Same random workload on two arenas, one compacted in the background and one
+// not; logs largest free block over time and checks that moves keep the data
+void fragmentation_soak_task(void *pvParameters) {
+    static movable_arena_t compacted, fixed;
+    static movable_handle_t handles[2][SOAK_MAX_LIVE];
+    static uint8_t patterns[SOAK_MAX_LIVE];
+    movable_arena_t* arenas[2] = { &compacted, &fixed };
+    uint32_t rng = 0x2545F491;      // fixed seed: both arenas see the same sequence
+    int live = 0;
+    uint32_t corrupt = 0;
+    float frag_sum[2] = {0}; int frag_samples = 0;
+    
+    ESP_LOGI(TAG, "🧲 Fragmentation soak started");
+    if (!movable_arena_init(&compacted, "Compacted", SOAK_REGION_SIZE, true) ||
+        !movable_arena_init(&fixed, "Fixed", SOAK_REGION_SIZE, false)) {
+        vTaskDelete(NULL);
+        return;
+    }
+    
+    for (int op = 1; op <= SOAK_OPS; op++) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        
+        if (live < SOAK_MAX_LIVE && (live == 0 || rng % 100 < 55)) {
+            // 32-512 bytes, every 16th request 2 KB: only fits in a contiguous hole
+            const size_t size = (rng & 0xF0) == 0 ? 2048 : 32 + (rng >> 8) % 481;
+            patterns[live] = op & 0xFF;
+            for (int a = 0; a < 2; a++) {
+                handles[a][live] = movable_alloc(arenas[a], size);
+                uint8_t* p = movable_pin(arenas[a], handles[a][live]);
+                if (p) {
+                    memset(p, patterns[live], size);
+                    movable_unpin(arenas[a], handles[a][live]);
+                }
+            }
+            live++;
+        } else {
+            const int victim = (rng >> 8) % live;
+            for (int a = 0; a < 2; a++) {
+                const uint8_t* p = movable_pin(arenas[a], handles[a][victim]);
+                if (p) {
+                    if (p[0] != patterns[victim]) corrupt++;
+                    movable_unpin(arenas[a], handles[a][victim]);
+                    movable_free(arenas[a], handles[a][victim]);
+                }
+                handles[a][victim] = handles[a][live - 1];
+            }
+            patterns[victim] = patterns[live - 1];
+            live--;
+        }
+        
+        if (op % SOAK_REPORT_EVERY == 0) {
+            size_t free_c, free_f;
+            const size_t largest_c = movable_largest_free(&compacted, &free_c);
+            const size_t largest_f = movable_largest_free(&fixed, &free_f);
+            ESP_LOGI(TAG, "🧲 op %4d: compacted largest %5d/%5d free (%lu fails) | fixed %5d/%5d (%lu fails)",
+                     op, (int)largest_c, (int)free_c, (unsigned long)compacted.alloc_failures,
+                     (int)largest_f, (int)free_f, (unsigned long)fixed.alloc_failures);
+        }
+        if (op % 10 == 0) {
+            for (int a = 0; a < 2; a++) {
+                size_t total_free;
+                const size_t largest = movable_largest_free(arenas[a], &total_free);
+                if (total_free > 0) frag_sum[a] += 1.0f - (float)largest / total_free;
+            }
+            frag_samples++;
+            vTaskDelay(pdMS_TO_TICKS(20));   // let the compactor run
+        }
+    }
+    
+    ESP_LOGI(TAG, "🧲 Soak done: mean fragmentation %.1f%% compacted vs %.1f%% fixed, failures %lu vs %lu",
+             frag_sum[0] * 100 / frag_samples, frag_sum[1] * 100 / frag_samples,
+             (unsigned long)compacted.alloc_failures, (unsigned long)fixed.alloc_failures);
+    ESP_LOGI(TAG, "🧲 Compactor: %lu moves, %d bytes moved, max pause %lu μs, %lu corrupted blocks",
+             (unsigned long)compacted.moves, (int)compacted.bytes_moved, (unsigned long)compacted.max_pause_us,
+             (unsigned long)corrupt);
+    vTaskDelete(NULL);
+}
+
 void memory_monitor_task(void *pvParameters) {
     ESP_LOGI(TAG, "📊 Memory monitor started");
     
@@ -408,6 +2036,10 @@ void memory_monitor_task(void *pvParameters) {
         analyze_memory_status();
         print_allocation_summary();
         detect_memory_leaks();
+        print_task_heap_usage();
+#if HEAP_INTERPOSE_ENABLED
+        heap_interpose_report();
+#endif
         
         // Check heap integrity
         if (!heap_caps_check_integrity_all(true)) {
@@ -416,7 +2048,7 @@ void memory_monitor_task(void *pvParameters) {
         }
         
         ESP_LOGI(TAG, "Free heap: %d bytes", esp_get_free_heap_size());
-        ESP_LOGI(TAG, "System uptime: %llu ms\n", esp_timer_get_time() / 1000);
+        ESP_LOGI(TAG, "System uptime: %llu ms\n", (unsigned long long)(esp_timer_get_time() / 1000));
     }
 }
 
@@ -472,7 +2104,7 @@ void heap_integrity_test_task(void *pvParameters) {
             uint64_t read_time = esp_timer_get_time() - start;
             
             ESP_LOGI(TAG, "🔍 Performance: Write %llu μs, Read %llu μs", 
-                     write_time, read_time);
+                     (unsigned long long)write_time, (unsigned long long)read_time);
             
             tracked_free(test_buf, "PerfTest");
         }
@@ -496,16 +2128,15 @@ void app_main(void) {
     gpio_set_level(LED_FRAGMENTATION, 0);
     gpio_set_level(LED_SPIRAM_ACTIVE, 0);
     
-    // Create mutex for memory tracking
-    memory_mutex = xSemaphoreCreateMutex();
-    if (!memory_mutex) {
-        ESP_LOGE(TAG, "Failed to create memory mutex!");
+    // Heap event trace ring (drained by the HeapTrace task)
+    heap_trace_init();
+    
+    // Create mutex and hash-indexed table for memory tracking
+    if (!tracking_init()) {
+        ESP_LOGE(TAG, "Failed to initialize memory tracking!");
         return;
     }
     
-    // Initialize allocation tracking
-    memset(allocations, 0, sizeof(allocations));
-    
     ESP_LOGI(TAG, "Memory tracking system initialized");
     
     // Initial memory analysis
@@ -520,6 +2151,10 @@ void app_main(void) {
         heap_caps_print_heap_info(MALLOC_CAP_SPIRAM);
     }
     
+    // Tracking overhead at increasing live-allocation counts (before the test tasks start)
+    benchmark_tracking_cost();
+    benchmark_tracker_layout();
+    
     // Create test tasks
     ESP_LOGI(TAG, "Creating memory test tasks...");
     
@@ -528,6 +2163,16 @@ void app_main(void) {
     xTaskCreate(memory_pool_test_task, "PoolTest", 3072, NULL, 5, NULL);
     xTaskCreate(large_allocation_test_task, "LargeAlloc", 2048, NULL, 4, NULL);
     xTaskCreate(heap_integrity_test_task, "IntegrityTest", 3072, NULL, 3, NULL);
+    xTaskCreate(heap_trace_drain_task, "HeapTrace", 3072, NULL, 1, NULL);
+    xTaskCreate(leak_demo_task, "LeakDemo", 2048, NULL, 4, NULL);
+    xTaskCreate(memory_pressure_task, "MemPressure", 3072, NULL, 6, NULL);
+    
+    TaskHandle_t runaway = NULL;
+    xTaskCreate(runaway_task, "Runaway", 2048, NULL, 4, &runaway);
+    if (runaway) task_quota_set(runaway, RUNAWAY_QUOTA, TASK_QUOTA_FAIL);
+    
+    xTaskCreate(movable_compactor_task, "Compactor", 2048, NULL, 2, NULL);
+    xTaskCreate(fragmentation_soak_task, "FragSoak", 3072, NULL, 3, NULL);
     
     ESP_LOGI(TAG, "All tasks created successfully");
     
@@ -539,12 +2184,19 @@ void app_main(void) {
     ESP_LOGI(TAG, "  GPIO19 - SPIRAM Active (Blue)");
     
     ESP_LOGI(TAG, "\n🔬 Test Features:");
-    ESP_LOGI(TAG, "  • Dynamic Memory Allocation Tracking");
+    ESP_LOGI(TAG, "  • Dynamic Memory Allocation Tracking (hash-indexed, O(1), SoA records)");
     ESP_LOGI(TAG, "  • Real-time Memory Status Monitoring");
-    ESP_LOGI(TAG, "  • Memory Leak Detection");
+    ESP_LOGI(TAG, "  • Memory Leak Detection (epoch-based, per call site)");
+    ESP_LOGI(TAG, "  • Memory-pressure Shrinkers (watermarks with hysteresis)");
+    ESP_LOGI(TAG, "  • Per-task Heap Accounting and Quotas");
+    ESP_LOGI(TAG, "  • Relocatable Handles with Online Compaction");
     ESP_LOGI(TAG, "  • Fragmentation Analysis");
     ESP_LOGI(TAG, "  • Heap Integrity Checking");
     ESP_LOGI(TAG, "  • Memory Performance Testing");
+    ESP_LOGI(TAG, "  • Binary Heap Event Trace (tools/heap_trace.py)");
+#if HEAP_INTERPOSE_ENABLED
+    ESP_LOGI(TAG, "  • Whole-program Heap Interposition (per call site)");
+#endif
     
     ESP_LOGI(TAG, "Heap Management System operational!");
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Offline analysis of the heap_management binary heap-event trace.
+
+Input is either
+  * an `idf.py monitor` capture containing "#HT:<base64>" lines (target), or
+  * a raw trace file starting with "HTR1" ($HEAP_TRACE_FILE on host builds).
+
+The tool replays ALLOC/FREE events to rebuild heap occupancy over time, takes
+fragmentation from the periodic HEAP snapshots, and lists leak candidates:
+blocks still live at the end of the trace and older than --leak-age.
+
+    python tools/heap_trace.py monitor.log
+    python tools/heap_trace.py heap_trace.bin --interval 5 --csv timeline.csv
+"""
+
+import argparse
+import base64
+import csv
+import re
+import struct
+import sys
+from collections import defaultdict
+
+RECORD = struct.Struct("<IIIIHBB")      # heap_event_t, 20 bytes
+EV_ALLOC, EV_FREE, EV_FAIL, EV_TASK, EV_HEAP, EV_DROPPED = range(1, 7)
+TASK_UNKNOWN = 0xFF
+LINE_RE = re.compile(r"#HT:([A-Za-z0-9+/=]+)")
+
+
+def read_records(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data.startswith(b"HTR1"):
+        payload = data[4:]
+    else:
+        text = data.decode("utf-8", errors="replace")
+        payload = b"".join(base64.b64decode(m.group(1)) for m in LINE_RE.finditer(text))
+    usable = len(payload) - len(payload) % RECORD.size
+    for off in range(0, usable, RECORD.size):
+        ts, a, b, c, seq, op, task = RECORD.unpack_from(payload, off)
+        yield ts, a, b, c, seq, op, task, payload[off + 4:off + 16]
+
+
+def analyze(path, interval_s, leak_age_s):
+    tasks = {TASK_UNKNOWN: "?"}
+    live = {}                       # ptr -> (size, caps, task, t_us)
+    live_bytes = 0
+    timeline = []                   # (t_s, live_bytes, live_blocks, free, largest, frag)
+    heap_free = heap_largest = None
+    counts = defaultdict(int)
+    unknown_frees = lost_events = seq_gaps = 0
+    last_ts = wrap = 0
+    last_seq = None
+    next_sample = None
+    t_us = 0
+
+    for ts, a, b, c, seq, op, task, raw in read_records(path):
+        # Unwrap the 32-bit microsecond clock
+        if ts < last_ts and last_ts - ts > 1 << 31:
+            wrap += 1 << 32
+        last_ts = ts
+        t_us = wrap + ts
+        if last_seq is not None and seq != (last_seq + 1) & 0xFFFF:
+            seq_gaps += (seq - last_seq - 1) & 0xFFFF
+        last_seq = seq
+        counts[op] += 1
+
+        # Sample points before this event see the state before it is applied
+        if next_sample is None:                 # timeline starts at the first event
+            next_sample = int(t_us / 1e6 / interval_s) * interval_s
+        while t_us / 1e6 > next_sample:
+            frag = (1.0 - heap_largest / heap_free) if heap_free else None
+            timeline.append((next_sample, live_bytes, len(live), heap_free, heap_largest, frag))
+            next_sample += interval_s
+
+        if op == EV_ALLOC:
+            if a in live:                       # missed FREE (lost output)
+                live_bytes -= live[a][0]
+            live[a] = (b, c, task, t_us)
+            live_bytes += b
+        elif op == EV_FREE:
+            block = live.pop(a, None)
+            if block:
+                live_bytes -= block[0]
+            else:
+                unknown_frees += 1
+        elif op == EV_TASK:
+            tasks[task] = raw.split(b"\0", 1)[0].decode("ascii", errors="replace")
+        elif op == EV_HEAP:
+            heap_free, heap_largest = a, b
+        elif op == EV_DROPPED:
+            lost_events += a
+
+    return {
+        "tasks": tasks, "live": live, "live_bytes": live_bytes, "timeline": timeline,
+        "counts": counts, "unknown_frees": unknown_frees, "lost_events": lost_events,
+        "seq_gaps": seq_gaps, "end_us": t_us, "leak_age_us": leak_age_s * 1e6,
+    }
+
+
+def report(r, top):
+    c = r["counts"]
+    print("═══ HEAP TRACE ═══")
+    start = r["timeline"][0][0] if r["timeline"] else 0.0
+    print(f"Duration:        {start:.1f} .. {r['end_us'] / 1e6:.1f} s")
+    print(f"Events:          {c[EV_ALLOC]} alloc, {c[EV_FREE]} free, {c[EV_FAIL]} failed, "
+          f"{c[EV_HEAP]} snapshots")
+    print(f"Lost:            {r['lost_events']} dropped in ring, {r['seq_gaps']} missing in output, "
+          f"{r['unknown_frees']} frees of unknown blocks")
+    print(f"Live at end:     {r['live_bytes']} bytes in {len(r['live'])} blocks")
+
+    print("\n═══ TIMELINE ═══")
+    print(f"{'t (s)':>8} {'live B':>9} {'blocks':>7} {'free B':>9} {'largest':>9} {'frag':>6}")
+    for t, lb, blocks, free, largest, frag in r["timeline"]:
+        frag_s = f"{frag * 100:5.1f}%" if frag is not None else "   n/a"
+        print(f"{t:8.1f} {lb:9d} {blocks:7d} {free if free is not None else '-':>9} "
+              f"{largest if largest is not None else '-':>9} {frag_s}")
+
+    # Leak candidates: old live blocks grouped by (task, size)
+    groups = defaultdict(lambda: [0, 0, 0])     # count, bytes, oldest age
+    for ptr, (size, caps, task, born) in r["live"].items():
+        age = r["end_us"] - born
+        if age >= r["leak_age_us"]:
+            g = groups[(r["tasks"].get(task, f"#{task}"), size)]
+            g[0] += 1
+            g[1] += size
+            g[2] = max(g[2], age)
+    print(f"\n═══ LEAK CANDIDATES (live > {r['leak_age_us'] / 1e6:g} s) ═══")
+    if not groups:
+        print("none")
+    for (task, size), (count, total, oldest) in sorted(groups.items(), key=lambda kv: -kv[1][1])[:top]:
+        print(f"{task:<16} {count:5d} x {size:6d} B = {total:8d} B, oldest {oldest / 1e6:.1f} s")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input", help="monitor log with #HT: lines, or HTR1 binary file")
+    ap.add_argument("--interval", type=float, default=1.0, help="timeline sample period in seconds")
+    ap.add_argument("--leak-age", type=float, default=30.0, help="minimum age of a leak candidate in seconds")
+    ap.add_argument("--top", type=int, default=20, help="leak candidate groups to list")
+    ap.add_argument("--csv", help="also write the timeline to this CSV file")
+    args = ap.parse_args()
+
+    r = analyze(args.input, args.interval, args.leak_age)
+    if not r["counts"]:
+        sys.exit(f"{args.input}: no heap trace records found")
+    report(r, args.top)
+
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            w = csv.writer(f)
+            w.writerow(["t_s", "live_bytes", "live_blocks", "free_bytes", "largest_free", "fragmentation"])
+            w.writerows(r["timeline"])
+
+
+if __name__ == "__main__":
+    main()
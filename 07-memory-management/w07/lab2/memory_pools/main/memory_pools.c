@@ -9,9 +9,15 @@
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "sdkconfig.h"
 #include "esp_system.h"
 #include "driver/gpio.h"
 #include "esp_random.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "mem_kernels.h"
 
 static const char *TAG = "MEM_POOLS";
 
@@ -22,7 +28,7 @@ static const char *TAG = "MEM_POOLS";
 #define LED_POOL_FULL      GPIO_NUM_18  // Pool exhaustion
 #define LED_POOL_ERROR     GPIO_NUM_19  // Pool error/corruption
 
-// Memory pool configurations
+// Memory pool configurations (defaults; a stored size profile overrides them at boot)
 #define SMALL_POOL_BLOCK_SIZE   64
 #define SMALL_POOL_BLOCK_COUNT  32
 
@@ -35,6 +41,56 @@ static const char *TAG = "MEM_POOLS";
 #define HUGE_POOL_BLOCK_SIZE    4096
 #define HUGE_POOL_BLOCK_COUNT   4
 
+// Benchmark configuration
+#define MIXED_FREE_COUNT        16
+#define MIXED_FREE_ROUNDS       50
+#define ISR_PATH_ROUNDS         200
+#define BATCH_BENCH_ROUNDS      50
+#define ALIGN_BENCH_BYTES       1024
+#define ALIGN_BENCH_ROUNDS      200
+
+// Typed object pools (handle = generation | index)
+#define OBJ_HANDLE_NULL         0
+#define OBJ_POOL_MAX_OBJECTS    0xFFFE  // index 0xFFFF is the free-stack terminator
+#define OBJ_MIN_GEN_BITS        4       // a 16-bit handle must keep at least this many generation bits
+#define OBJ_MSG_POOL_SIZE       32
+#define OBJ_MSG_QUEUE_LEN       16
+#define OBJ_MSG_SAMPLES         16
+#define OBJ_STALE_PROBE_EVERY   16      // consumer re-tries a freed handle every N messages
+
+// Buddy tier for requests above the Huge pool (and for exhausted pools)
+#define BUDDY_MIN_ORDER         12      // 4 KB smallest buddy block
+#define BUDDY_MAX_ORDER         16      // 64 KB region (halved at init until it fits)
+#define BUDDY_ORDERS            (BUDDY_MAX_ORDER - BUDDY_MIN_ORDER + 1)
+#define BUDDY_MAX_BLOCKS        (1 << (BUDDY_MAX_ORDER - BUDDY_MIN_ORDER))
+#define BUDDY_TAG_FREE          0x80    // order tag flag: block is on a free list
+#define BUDDY_TAG_NONE          0xFF    // min-block is inside a larger block
+#define BUDDY_SOAK_SLOTS        8
+#define BUDDY_SOAK_OPS          400
+#define BUDDY_SOAK_MIN_BYTES    4096
+#define BUDDY_SOAK_MAX_BYTES    (16 * 1024)
+
+// Incremental integrity scanner
+#define POOL_SCAN_BUDGET_US     200     // default scan time per tick
+#define POOL_SCAN_TICK_MS       20
+#define POOL_SCAN_SLICE_BLOCKS  8       // blocks checked per pool->mutex hold
+#define POOL_SCAN_SUSPECTS      8       // mismatches waiting for confirmation
+
+// Size profiler / profile-guided pool sizing
+#define POOL_PROFILE_BIN_BYTES      16      // histogram granularity
+#define POOL_PROFILE_BINS           256     // covers 1..4096 bytes
+#define POOL_PROFILE_SAMPLE_RATE    8       // record 1 of every N smart_pool_malloc calls
+#define POOL_PROFILE_EXHAUST_WEIGHT 8       // a sampled request that hit a full pool counts N times
+#define POOL_PROFILE_MIN_SAMPLES    256     // fewer samples than this: keep the defaults
+#define POOL_PROFILE_MIN_BLOCKS     2
+#define POOL_PROFILE_MAX_BLOCKS     256
+#define POOL_PROFILE_SAVE_EVERY     20      // monitor cycles between NVS saves (~5 min)
+#define POOL_RAM_BUDGET             (30 * 1024)   // bytes for the first slab of all pools
+#define POOL_PROFILE_NVS_NAMESPACE  "mem_pools"
+#define POOL_PROFILE_NVS_KEY        "profile"
+#define POOL_MAGIC_PROFILE          0x504F4F4C    // "POOL"
+#define POOL_PROFILE_VERSION        1
+
 // ====== Pool management structures ======
 typedef struct memory_block {
     struct memory_block* next;
@@ -43,26 +99,115 @@ typedef struct memory_block {
     uint64_t alloc_time;   // When was this allocated
 } memory_block_t;
 
+// Block layout: classic in-band header, or header-less with all per-block state
+// kept out of band (usage_bitmap + alloc_times) and the free list threaded
+// through the free payloads themselves.
+typedef enum {
+    POOL_LAYOUT_HEADER = 0,
+    POOL_LAYOUT_HEADERLESS
+} pool_layout_t;
+
+// Header-less free block: `next` overlays the payload, `canary` guards it
+typedef struct {
+    void* next;
+    uint32_t canary;
+} pool_free_node_t;
+
+// Per-core magazine: a small stack of free blocks in front of the shared free_list.
+// Guarded by its own spinlock, which is only ever contended by tasks on the same
+// core (or a task that migrated mid-operation), so hits never touch pool->mutex.
+#define POOL_MAGAZINE_SIZE      8    // max cached blocks per core (0 = disable magazines)
+
+typedef struct {
+    portMUX_TYPE lock;
+    memory_block_t* blocks[POOL_MAGAZINE_SIZE > 0 ? POOL_MAGAZINE_SIZE : 1];
+    uint32_t count;
+
+    // Statistics (updated inside lock)
+    uint32_t allocs;       // attempts, including failures
+    uint32_t frees;
+    uint32_t alloc_hits;   // served without pool->mutex
+    uint32_t free_hits;    // absorbed without pool->mutex
+} pool_magazine_t;
+
+// Latency histogram: log2 buckets of CPU cycles, updated lock-free from any core
+#define POOL_HIST_BUCKETS       32
+#define POOL_HIST_RESET_EVERY   4    // monitor dumps per histogram window (0 = never reset)
+
+typedef struct {
+    uint32_t buckets[POOL_HIST_BUCKETS];  // bucket k counts samples in [2^k, 2^(k+1)) cycles
+    uint32_t count;
+    uint32_t max;
+    uint32_t migrated;   // dropped: task changed core mid-measurement (CCOUNT is per core)
+} pool_hist_t;
+
 typedef struct {
+    uint32_t cycles;
+    int core;
+} pool_stamp_t;
+
+// One contiguous arena of blocks. Every pool starts with a permanent slab and
+// chains extra slabs on exhaustion; extra slabs go back to the heap once idle.
+typedef struct pool_slab {
+    struct pool_slab* next;
+    struct memory_pool* pool;
+    uint8_t* memory;
+    memory_block_t* free_list;
+    uint32_t* usage_bitmap;  // 1 bit/block, updated atomically (set = owned by caller)
+    uint64_t* alloc_times;   // header-less: side table of allocation timestamps
+    size_t block_count;
+    size_t in_use;           // blocks off this slab's free list (callers + magazines)
+    uint64_t empty_since;    // when in_use last dropped to 0
+    bool permanent;          // the initial slab is never released
+} pool_slab_t;
+
+typedef struct memory_pool {
     const char* name;
     size_t block_size;
-    size_t block_count;
+    size_t block_count;     // total across all slabs
     size_t alignment;
+    size_t block_stride;    // header + aligned payload
+    size_t header_size;     // 0 for header-less layout
+    pool_layout_t layout;
+    bool canary;            // header-less: poison free payloads to catch use-after-free
     uint32_t caps;
-
-    // Pool memory
-    void* pool_memory;
-    memory_block_t* free_list;
-    uint8_t* usage_bitmap;  // byte-accurate bitmap (1 bit/block)
+    uint32_t slab_caps;     // resolved caps (after SPIRAM fallback) for every slab
+
+    // Slabs
+    pool_slab_t* slabs;
+    size_t slab_blocks;     // blocks per slab
+    size_t slab_count;
+    size_t max_slabs;
+    uint64_t slab_idle_us;  // release fully-free extra slabs after this long
+    uint32_t slabs_grown;
+    uint32_t slabs_released;
+
+    // ISR reserve: the first isr_reserve blocks of the permanent slab live on a
+    // lock-free stack instead of the free list, so ISRs never need pool->mutex
+    pool_slab_t* isr_slab;
+    size_t isr_reserve;
+    uint16_t* isr_next;     // next index per reserve block (out of band)
+    uint32_t isr_head;      // (ABA tag << 16) | index, POOL_ISR_NIL index when empty
+    uint32_t isr_allocs;
+    uint32_t isr_failures;
+
+    // Per-core magazines
+    pool_magazine_t magazines[portNUM_PROCESSORS];
+    size_t magazine_capacity;  // per core, scaled down for small pools
+    size_t magazine_batch;     // blocks moved per refill/spill
 
     // Statistics
-    size_t allocated_blocks;
+    size_t allocated_blocks;   // blocks held by callers (atomic)
     size_t peak_usage;
-    uint64_t total_allocations;
-    uint64_t total_deallocations;
-    uint64_t allocation_time_total;
-    uint64_t deallocation_time_total;
-    uint32_t allocation_failures;
+    uint32_t allocation_failures; // blocks requested but not handed out (atomic)
+    uint32_t lock_acquisitions;   // pool->mutex takes on the alloc/free path (inside the lock)
+
+    // Latency histograms (CPU cycles)
+    pool_hist_t hist_alloc;       // pool_malloc, or per block of pool_malloc_batch
+    pool_hist_t hist_free;        // pool_free, or per block of pool_free_batch
+    pool_hist_t hist_lock_wait;   // blocked in xSemaphoreTake(pool->mutex)
+    pool_hist_t hist_lock_hold;   // pool->mutex held on the alloc/free path
+    pool_stamp_t lock_taken;      // written only by the current mutex holder
 
     // Synchronization
     SemaphoreHandle_t mutex;
@@ -86,213 +231,1478 @@ static bool pools_initialized = false;
 typedef struct {
     const char* name;
     size_t block_size;
-    size_t block_count;
+    size_t block_count;     // blocks per slab
     uint32_t caps;
     gpio_num_t led_pin;
+    pool_layout_t layout;
+    bool canary;            // header-less only; header layout always checks magic
+    size_t max_slabs;       // 1 = fixed-size pool
+    size_t isr_reserve;     // blocks reserved for pool_malloc_from_isr
+    size_t alignment;       // payload alignment, power of two 4..POOL_MAX_ALIGNMENT
+    bool dma;               // MALLOC_CAP_DMA: payloads can go straight to SPI/I2C DMA
 } pool_config_t;
 
+// Small pool ใช้ header-less: 24-byte header = 37% overhead on 64-byte blocks
 static const pool_config_t pool_configs[POOL_COUNT] = {
-    {"Small",  SMALL_POOL_BLOCK_SIZE,  SMALL_POOL_BLOCK_COUNT,  MALLOC_CAP_INTERNAL,                    LED_SMALL_POOL},
-    {"Medium", MEDIUM_POOL_BLOCK_SIZE, MEDIUM_POOL_BLOCK_COUNT, MALLOC_CAP_INTERNAL,                    LED_MEDIUM_POOL},
-    {"Large",  LARGE_POOL_BLOCK_SIZE,  LARGE_POOL_BLOCK_COUNT,  MALLOC_CAP_DEFAULT,                     LED_LARGE_POOL},
-    {"Huge",   HUGE_POOL_BLOCK_SIZE,   HUGE_POOL_BLOCK_COUNT,   (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT),  LED_POOL_FULL}
+    {"Small",  SMALL_POOL_BLOCK_SIZE,  SMALL_POOL_BLOCK_COUNT,  MALLOC_CAP_INTERNAL,                    LED_SMALL_POOL,  POOL_LAYOUT_HEADERLESS, true,  4, 8, 4,  false},
+    {"Medium", MEDIUM_POOL_BLOCK_SIZE, MEDIUM_POOL_BLOCK_COUNT, MALLOC_CAP_INTERNAL,                    LED_MEDIUM_POOL, POOL_LAYOUT_HEADER,     false, 4, 4, 16, false},
+    {"Large",  LARGE_POOL_BLOCK_SIZE,  LARGE_POOL_BLOCK_COUNT,  MALLOC_CAP_DEFAULT,                     LED_LARGE_POOL,  POOL_LAYOUT_HEADER,     false, 2, 2, 32, true},
+    {"Huge",   HUGE_POOL_BLOCK_SIZE,   HUGE_POOL_BLOCK_COUNT,   (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT),  LED_POOL_FULL,   POOL_LAYOUT_HEADER,     false, 2, 0, 4,  false}
 };
 
+#define POOL_SLAB_IDLE_MS       30000   // extra slabs fully free this long are released
+#define POOL_RANGE_CAPACITY     16      // total slabs across all pools
+#define POOL_ISR_NIL            0xFFFF  // empty ISR reserve stack
+#define POOL_BATCH_MAX          32      // blocks per pool_free_batch lock round-trip
+#define POOL_MAX_ALIGNMENT      64      // largest payload alignment (cache line on S3/PSRAM)
+
+// Sampled request-size distribution, persisted to NVS between boots
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t samples;
+    uint32_t oversize;                        // larger than the last bin (always heap)
+    uint32_t bins[POOL_PROFILE_BINS];         // bin b: sizes (16b, 16(b+1)]
+    uint32_t exhausted[POOL_PROFILE_BINS];    // sampled requests whose pool was full
+} pool_profile_t;
+
+static pool_profile_t pool_profile;
+static uint32_t pool_profile_tick = 0;
+static pool_config_t pool_active_configs[POOL_COUNT];   // what app_main actually built
+
 // Magic numbers
 #define POOL_MAGIC_FREE    0xDEADBEEF
 #define POOL_MAGIC_ALLOC   0xCAFEBABE
 
+// Address-range index over all slabs, sorted by start address.
+// Readers are lock-free (seqlock retry); writers only run when a slab is
+// added or released, and never touch block headers.
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;          // exclusive
+    pool_slab_t* slab;
+} pool_range_t;
+
+static pool_range_t pool_ranges[POOL_RANGE_CAPACITY];
+static int pool_range_count = 0;
+static uint32_t pool_range_seq = 0;     // odd while a writer is mid-update
+static portMUX_TYPE pool_range_lock = portMUX_INITIALIZER_UNLOCKED;
+
 // ====== Pool management ======
 static inline size_t align_up(size_t v, size_t a) { return (v + (a - 1)) & ~(a - 1); }
 
+static size_t pool_config_alignment(const pool_config_t* config) {
+    size_t align = 4;
+    while (align < config->alignment && align < POOL_MAX_ALIGNMENT) align <<= 1;
+    return align;
+}
+
+// Block stride for a config. The header is padded to the alignment too, so with an
+// aligned slab base every payload (block + header_size) lands on the boundary.
+static size_t pool_config_stride(const pool_config_t* config, size_t* header_size) {
+    const size_t align       = pool_config_alignment(config);
+    const size_t header      = (config->layout == POOL_LAYOUT_HEADER) ? align_up(sizeof(memory_block_t), align) : 0;
+    const size_t min_payload = (config->layout == POOL_LAYOUT_HEADER) ? 1 : sizeof(pool_free_node_t);
+    const size_t payload     = align_up(config->block_size > min_payload ? config->block_size : min_payload, align);
+    if (header_size) *header_size = header;
+    return header + payload;
+}
+
+// ====== Latency histograms ======
+static inline pool_stamp_t pool_stamp(void) {
+    pool_stamp_t s = { esp_cpu_get_cycle_count(), xPortGetCoreID() };
+    return s;
+}
+
+static inline void pool_hist_add(pool_hist_t* h, uint32_t cycles, uint32_t n) {
+    const int k = cycles ? 31 - __builtin_clz(cycles) : 0;
+    __atomic_add_fetch(&h->buckets[k], n, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->count, n, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (cycles > max &&
+           !__atomic_compare_exchange_n(&h->max, &max, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Record the time since `start`; batch operations record n samples of the per-block cost
+static inline void pool_hist_since(pool_hist_t* h, pool_stamp_t start, uint32_t n) {
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start.cycles;
+    if (xPortGetCoreID() != start.core) {
+        __atomic_add_fetch(&h->migrated, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (n == 0) n = 1;
+    pool_hist_add(h, cycles / n, n);
+}
+
+// Upper bound of the bucket holding the given percentile (in 1/100 %), capped at max
+static uint32_t pool_hist_percentile(const pool_hist_t* h, uint32_t basis_points) {
+    if (h->count == 0) return 0;
+    const uint64_t target = ((uint64_t)h->count * basis_points + 9999) / 10000;
+    uint64_t seen = 0;
+    for (int k = 0; k < POOL_HIST_BUCKETS; k++) {
+        seen += h->buckets[k];
+        if (seen >= target) {
+            const uint32_t upper = (k >= 31) ? UINT32_MAX : ((2U << k) - 1);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void pool_reset_histograms(memory_pool_t* pool) {
+    // Samples racing with the reset land in either window; good enough for monitoring
+    memset(&pool->hist_alloc, 0, sizeof(pool_hist_t));
+    memset(&pool->hist_free, 0, sizeof(pool_hist_t));
+    memset(&pool->hist_lock_wait, 0, sizeof(pool_hist_t));
+    memset(&pool->hist_lock_hold, 0, sizeof(pool_hist_t));
+}
+
+// pool->mutex on the alloc/free path: wait and hold times go to the histograms
+static bool pool_lock(memory_pool_t* pool, TickType_t timeout) {
+    const pool_stamp_t start = pool_stamp();
+    const bool taken = xSemaphoreTake(pool->mutex, timeout) == pdTRUE;
+    pool_hist_since(&pool->hist_lock_wait, start, 1);
+    if (!taken) return false;
+    pool->lock_acquisitions++;
+    pool->lock_taken = pool_stamp();
+    return true;
+}
+
+static void pool_unlock(memory_pool_t* pool) {
+    pool_hist_since(&pool->hist_lock_hold, pool->lock_taken, 1);
+    xSemaphoreGive(pool->mutex);
+}
+
+static inline size_t slab_block_index(const memory_pool_t* pool, const pool_slab_t* slab, const memory_block_t* block) {
+    return ((const uint8_t*)block - slab->memory) / pool->block_stride;
+}
+
+FORCE_INLINE_ATTR void pool_bitmap_set(pool_slab_t* slab, size_t index) {
+    __atomic_fetch_or(&slab->usage_bitmap[index / 32], 1UL << (index % 32), __ATOMIC_RELAXED);
+}
+
+FORCE_INLINE_ATTR void pool_bitmap_clear(pool_slab_t* slab, size_t index) {
+    __atomic_fetch_and(&slab->usage_bitmap[index / 32], ~(1UL << (index % 32)), __ATOMIC_RELAXED);
+}
+
+FORCE_INLINE_ATTR bool pool_bitmap_test(const pool_slab_t* slab, size_t index) {
+    return (__atomic_load_n(&slab->usage_bitmap[index / 32], __ATOMIC_RELAXED) >> (index % 32)) & 1U;
+}
+
+// Is this free-list/magazine block intact? (header magic, or header-less canary)
+static inline bool pool_free_block_ok(const memory_pool_t* pool, const memory_block_t* block) {
+    if (pool->layout == POOL_LAYOUT_HEADER) {
+        return block->magic == POOL_MAGIC_FREE && block->pool_id == pool->pool_id;
+    }
+    return !pool->canary || ((const pool_free_node_t*)block)->canary == POOL_MAGIC_FREE;
+}
+
+// Treiber stack over 16-bit indices with out-of-band next links. The 16-bit tag
+// in the head word is bumped on every update, so a pop that raced with pop+push
+// of the same index (ABA) fails its CAS instead of installing a stale next index.
+static inline uint32_t IRAM_ATTR index_stack_pop(uint32_t* stack_head, const uint16_t* links) {
+    uint32_t head = __atomic_load_n(stack_head, __ATOMIC_ACQUIRE);
+    uint32_t index, next;
+    do {
+        index = head & 0xFFFF;
+        if (index == POOL_ISR_NIL) return POOL_ISR_NIL;
+        next = (head & 0xFFFF0000) + 0x10000 + links[index];
+    } while (!__atomic_compare_exchange_n(stack_head, &head, next, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return index;
+}
+
+static inline void IRAM_ATTR index_stack_push(uint32_t* stack_head, uint16_t* links, size_t index) {
+    uint32_t head = __atomic_load_n(stack_head, __ATOMIC_RELAXED);
+    uint32_t next;
+    do {
+        links[index] = (uint16_t)(head & 0xFFFF);
+        next = (head & 0xFFFF0000) + 0x10000 + (uint32_t)index;
+    } while (!__atomic_compare_exchange_n(stack_head, &head, next, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static inline uint32_t IRAM_ATTR pool_isr_pop(memory_pool_t* pool) {
+    return index_stack_pop(&pool->isr_head, pool->isr_next);
+}
+
+static inline void IRAM_ATTR pool_isr_push(memory_pool_t* pool, size_t index) {
+    index_stack_push(&pool->isr_head, pool->isr_next, index);
+}
+
+static bool pool_index_register(pool_slab_t* slab) {
+    bool ok = false;
+    const uintptr_t start = (uintptr_t)slab->memory;
+    portENTER_CRITICAL(&pool_range_lock);
+    if (pool_range_count < POOL_RANGE_CAPACITY) {
+        __atomic_add_fetch(&pool_range_seq, 1, __ATOMIC_RELEASE);
+        int pos = pool_range_count;
+        while (pos > 0 && pool_ranges[pos - 1].start > start) {
+            pool_ranges[pos] = pool_ranges[pos - 1];
+            pos--;
+        }
+        pool_ranges[pos].start = start;
+        pool_ranges[pos].end   = start + slab->pool->block_stride * slab->block_count;
+        pool_ranges[pos].slab  = slab;
+        pool_range_count++;
+        __atomic_add_fetch(&pool_range_seq, 1, __ATOMIC_RELEASE);
+        ok = true;
+    }
+    portEXIT_CRITICAL(&pool_range_lock);
+    return ok;
+}
+
+static void pool_index_unregister(pool_slab_t* slab) {
+    portENTER_CRITICAL(&pool_range_lock);
+    __atomic_add_fetch(&pool_range_seq, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < pool_range_count; i++) {
+        if (pool_ranges[i].slab != slab) continue;
+        for (int j = i; j < pool_range_count - 1; j++) pool_ranges[j] = pool_ranges[j + 1];
+        pool_range_count--;
+        break;
+    }
+    __atomic_add_fetch(&pool_range_seq, 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&pool_range_lock);
+}
+
+// O(log slabs) lookup: NULL means the pointer came from the heap
+static pool_slab_t* pool_find_slab(const void* ptr) {
+    const uintptr_t addr = (uintptr_t)ptr;
+    pool_slab_t* found;
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&pool_range_seq, __ATOMIC_ACQUIRE);
+        found = NULL;
+        int lo = 0;
+        int hi = __atomic_load_n(&pool_range_count, __ATOMIC_RELAXED) - 1;
+        if (hi >= POOL_RANGE_CAPACITY) hi = POOL_RANGE_CAPACITY - 1;
+        while (lo <= hi) {
+            const int mid = (lo + hi) / 2;
+            if (addr < __atomic_load_n(&pool_ranges[mid].start, __ATOMIC_RELAXED))     hi = mid - 1;
+            else if (addr >= __atomic_load_n(&pool_ranges[mid].end, __ATOMIC_RELAXED)) lo = mid + 1;
+            else { found = __atomic_load_n(&pool_ranges[mid].slab, __ATOMIC_RELAXED); break; }
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&pool_range_seq, __ATOMIC_RELAXED));
+    return found;
+}
+
+memory_pool_t* pool_find_owner(const void* ptr) {
+    pool_slab_t* slab = pool_find_slab(ptr);
+    return slab ? slab->pool : NULL;
+}
+
+static void pool_slab_destroy(pool_slab_t* slab) {
+    if (!slab) return;
+    heap_caps_free(slab->memory);
+    heap_caps_free(slab->usage_bitmap);
+    heap_caps_free(slab->alloc_times);
+    heap_caps_free(slab);
+}
+
+// The first `reserved` blocks stay off the free list (ISR reserve of the permanent slab)
+static pool_slab_t* pool_slab_create(memory_pool_t* pool, size_t reserved) {
+    pool_slab_t* slab = (pool_slab_t*)heap_caps_calloc(1, sizeof(pool_slab_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!slab) return NULL;
+    slab->pool        = pool;
+    slab->block_count = pool->slab_blocks;
+    slab->empty_since = esp_timer_get_time();
+
+    slab->memory = (uint8_t*)heap_caps_aligned_alloc(pool->alignment, pool->block_stride * slab->block_count, pool->slab_caps);
+
+    // Bitmap (1 bit/block) อยู่ใน INTERNAL, word-sized for atomic updates
+    const size_t bitmap_words = (slab->block_count + 31) / 32;
+    slab->usage_bitmap = (uint32_t*)heap_caps_calloc(bitmap_words, sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_32BIT);
+    if (pool->layout == POOL_LAYOUT_HEADERLESS) {
+        slab->alloc_times = (uint64_t*)heap_caps_calloc(slab->block_count, sizeof(uint64_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!slab->memory || !slab->usage_bitmap || (pool->layout == POOL_LAYOUT_HEADERLESS && !slab->alloc_times)) {
+        pool_slab_destroy(slab);
+        return NULL;
+    }
+
+    // สร้าง free list
+    slab->in_use = reserved;
+    for (int i = 0; i < (int)slab->block_count; i++) {
+        memory_block_t* block = (memory_block_t*)(slab->memory + (i * pool->block_stride));
+        if (pool->layout == POOL_LAYOUT_HEADER) {
+            block->magic = POOL_MAGIC_FREE;
+            block->pool_id = pool->pool_id;
+            block->alloc_time = 0;
+        } else if (pool->canary) {
+            ((pool_free_node_t*)block)->canary = POOL_MAGIC_FREE;
+        }
+        if ((size_t)i < reserved) continue;
+        block->next = slab->free_list;
+        slab->free_list = block;
+    }
+    return slab;
+}
+
 bool init_memory_pool(memory_pool_t* pool, const pool_config_t* config, uint32_t pool_id) {
     if (!pool || !config) return false;
 
     memset(pool, 0, sizeof(memory_pool_t));
     pool->name        = config->name;
     pool->block_size  = config->block_size;
-    pool->block_count = config->block_count;
-    pool->alignment   = 4; // 4-byte alignment
+    pool->alignment   = pool_config_alignment(config);
     pool->caps        = config->caps;
     pool->pool_id     = pool_id;
-
-    // คำนวณขนาดจริงต่อบล็อก
-    const size_t header_size        = sizeof(memory_block_t);
-    const size_t aligned_block_size = align_up(config->block_size, pool->alignment);
-    const size_t total_block_size   = header_size + aligned_block_size;
-    const size_t total_memory       = total_block_size * config->block_count;
+    pool->layout      = config->layout;
+    pool->canary      = (config->layout == POOL_LAYOUT_HEADERLESS) && config->canary;
+    pool->slab_blocks = config->block_count;
+    pool->max_slabs   = config->max_slabs > 0 ? config->max_slabs : 1;
+    pool->slab_idle_us = (uint64_t)POOL_SLAB_IDLE_MS * 1000;
+
+    // คำนวณขนาดจริงต่อบล็อก (header-less: payload must still fit the free-list node)
+    size_t header_size;
+    const size_t total_block_size = pool_config_stride(config, &header_size);
+    const size_t total_memory     = total_block_size * config->block_count;
+    pool->block_stride = total_block_size;
+    pool->header_size  = header_size;
 
     // ขอ 8-bit capable เสมอ และทำ fallback ถ้าขอ SPIRAM แต่ไม่มี
     uint32_t req_caps = (config->caps | MALLOC_CAP_8BIT);
+    if (config->dma) {
+        // ESP32 DMA cannot reach PSRAM
+        if (req_caps & MALLOC_CAP_SPIRAM) {
+            ESP_LOGW(TAG, "%s pool: DMA requested, ignoring SPIRAM cap.", config->name);
+            req_caps = (req_caps & ~MALLOC_CAP_SPIRAM) | MALLOC_CAP_INTERNAL;
+        }
+        req_caps |= MALLOC_CAP_DMA;
+    }
     if ((req_caps & MALLOC_CAP_SPIRAM) && heap_caps_get_free_size(MALLOC_CAP_SPIRAM) == 0) {
         ESP_LOGW(TAG, "%s pool requested SPIRAM but none available. Falling back to INTERNAL DRAM.", config->name);
         req_caps = (req_caps & ~MALLOC_CAP_SPIRAM) | MALLOC_CAP_INTERNAL;
     }
+    pool->slab_caps = req_caps;
 
-    pool->pool_memory = heap_caps_malloc(total_memory, req_caps);
-    if (!pool->pool_memory) {
-        ESP_LOGE(TAG, "Failed to allocate memory for %s pool", config->name);
+    // Mutex
+    pool->mutex = xSemaphoreCreateMutex();
+    if (!pool->mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex for %s pool", config->name);
         return false;
     }
 
-    // Bitmap (1 bit/block) อยู่ใน INTERNAL 8-bit
-    const size_t bitmap_bytes = (config->block_count + 7) / 8;
-    pool->usage_bitmap = (uint8_t*)heap_caps_calloc(bitmap_bytes, 1, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
-    if (!pool->usage_bitmap) {
-        heap_caps_free(pool->pool_memory);
-        ESP_LOGE(TAG, "Failed to allocate bitmap for %s pool", config->name);
+    // ISR reserve (เก็บไว้ไม่เกินครึ่งพูล ให้ task ยังมีบล็อกใช้)
+    pool->isr_reserve = config->isr_reserve;
+    if (pool->isr_reserve > config->block_count / 2) pool->isr_reserve = config->block_count / 2;
+    if (pool->isr_reserve > 0) {
+        pool->isr_next = (uint16_t*)heap_caps_malloc(pool->isr_reserve * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!pool->isr_next) pool->isr_reserve = 0;
+    }
+
+    pool_slab_t* slab = pool_slab_create(pool, pool->isr_reserve);
+    if (!slab || !pool_index_register(slab)) {
+        pool_slab_destroy(slab);
+        heap_caps_free(pool->isr_next);
+        vSemaphoreDelete(pool->mutex);
+        pool->mutex = NULL;
+        ESP_LOGE(TAG, "Failed to allocate memory for %s pool", config->name);
         return false;
     }
+    slab->permanent   = true;
+    pool->slabs       = slab;
+    pool->slab_count  = 1;
+    pool->block_count = slab->block_count;
+
+    pool->isr_slab = slab;
+    for (size_t i = 0; i < pool->isr_reserve; i++) {
+        pool->isr_next[i] = (i + 1 < pool->isr_reserve) ? (uint16_t)(i + 1) : POOL_ISR_NIL;
+    }
+    pool->isr_head = pool->isr_reserve > 0 ? 0 : POOL_ISR_NIL;
+
+    // Magazines: never let the per-core caches hoard more than half of the pool
+    pool->magazine_capacity = (config->block_count - pool->isr_reserve) / (2 * portNUM_PROCESSORS);
+    if (pool->magazine_capacity > POOL_MAGAZINE_SIZE) pool->magazine_capacity = POOL_MAGAZINE_SIZE;
+    pool->magazine_batch = (pool->magazine_capacity + 1) / 2;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+        pool->magazines[c].lock = unlocked;
+    }
 
-    // สร้าง free list
-    uint8_t* memory_ptr = (uint8_t*)pool->pool_memory;
-    pool->free_list = NULL;
-    for (int i = 0; i < (int)config->block_count; i++) {
-        memory_block_t* block = (memory_block_t*)(memory_ptr + (i * total_block_size));
-        block->magic = POOL_MAGIC_FREE;
-        block->pool_id = pool_id;
-        block->alloc_time = 0;
-        block->next = pool->free_list;
-        pool->free_list = block;
+    ESP_LOGI(TAG, "✅ Initialized %s pool: %d blocks × %d bytes = %d total bytes (%s, align %d%s, magazine %d/core, up to %d slabs, ISR reserve %d)",
+             config->name, (int)config->block_count, (int)config->block_size, (int)total_memory,
+             pool->layout == POOL_LAYOUT_HEADER ? "header" : (pool->canary ? "header-less+canary" : "header-less"),
+             (int)pool->alignment, (req_caps & MALLOC_CAP_DMA) ? " DMA" : "",
+             (int)pool->magazine_capacity, (int)pool->max_slabs, (int)pool->isr_reserve);
+    return true;
+}
+
+// ====== Slab bookkeeping (caller holds pool->mutex) ======
+
+// Prefer the fullest slab that still has free blocks, so lightly used slabs drain and can be released
+static pool_slab_t* pool_pick_slab_locked(memory_pool_t* pool) {
+    pool_slab_t* best = NULL;
+    for (pool_slab_t* slab = pool->slabs; slab; slab = slab->next) {
+        if (slab->free_list && (!best || slab->in_use > best->in_use)) best = slab;
     }
+    return best;
+}
 
-    // Mutex
-    pool->mutex = xSemaphoreCreateMutex();
-    if (!pool->mutex) {
-        heap_caps_free(pool->pool_memory);
-        heap_caps_free(pool->usage_bitmap);
-        ESP_LOGE(TAG, "Failed to create mutex for %s pool", config->name);
-        return false;
+static memory_block_t* pool_slab_pop_locked(pool_slab_t* slab) {
+    memory_block_t* block = slab->free_list;
+    slab->free_list = block->next;
+    slab->in_use++;
+    return block;
+}
+
+static void pool_return_block_locked(memory_pool_t* pool, memory_block_t* block) {
+    pool_slab_t* slab = pool_find_slab(block);
+    if (!slab || slab->pool != pool) {
+        ESP_LOGE(TAG, "🚨 Block %p has no slab in %s pool!", block, pool->name);
+        gpio_set_level(LED_POOL_ERROR, 1);
+        return;
     }
+    block->next = slab->free_list;
+    slab->free_list = block;
+    if (--slab->in_use == 0) slab->empty_since = esp_timer_get_time();
+}
 
-    ESP_LOGI(TAG, "✅ Initialized %s pool: %d blocks × %d bytes = %d total bytes",
-             config->name, (int)config->block_count, (int)config->block_size, (int)total_memory);
-    return true;
+static pool_slab_t* pool_grow_locked(memory_pool_t* pool) {
+    if (pool->slab_count >= pool->max_slabs) return NULL;
+    pool_slab_t* slab = pool_slab_create(pool, 0);
+    if (!slab || !pool_index_register(slab)) {
+        pool_slab_destroy(slab);
+        ESP_LOGW(TAG, "⚠️ %s pool: could not grab a new slab", pool->name);
+        return NULL;
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->slab_count++;
+    pool->block_count += slab->block_count;
+    pool->slabs_grown++;
+    ESP_LOGI(TAG, "📈 %s pool grew to %d slabs (%d blocks)", pool->name, (int)pool->slab_count, (int)pool->block_count);
+    return slab;
+}
+
+// Move every cached block back to its slab. Caller holds pool->mutex.
+static int pool_reclaim_magazines_locked(memory_pool_t* pool) {
+    memory_block_t* batch[POOL_MAGAZINE_SIZE > 0 ? POOL_MAGAZINE_SIZE : 1];
+    int reclaimed = 0;
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        pool_magazine_t* mag = &pool->magazines[c];
+        uint32_t n = 0;
+        portENTER_CRITICAL(&mag->lock);
+        while (mag->count > 0) batch[n++] = mag->blocks[--mag->count];
+        portEXIT_CRITICAL(&mag->lock);
+        for (uint32_t i = 0; i < n; i++) pool_return_block_locked(pool, batch[i]);
+        reclaimed += n;
+    }
+    return reclaimed;
+}
+
+// Release extra slabs that have been completely free for slab_idle_us
+int pool_trim_idle_slabs(memory_pool_t* pool) {
+    if (!pool || !pool->mutex || pool->slab_count <= 1) return 0;
+    if (xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0;
+
+    // Cached blocks would otherwise pin their slab forever
+    pool_reclaim_magazines_locked(pool);
+
+    const uint64_t now = esp_timer_get_time();
+    int released = 0;
+    pool_slab_t** link = &pool->slabs;
+    while (*link) {
+        pool_slab_t* slab = *link;
+        if (!slab->permanent && slab->in_use == 0 && now - slab->empty_since >= pool->slab_idle_us) {
+            *link = slab->next;
+            pool_index_unregister(slab);
+            pool->slab_count--;
+            pool->block_count -= slab->block_count;
+            pool->slabs_released++;
+            pool_slab_destroy(slab);
+            released++;
+        } else {
+            link = &slab->next;
+        }
+    }
+    xSemaphoreGive(pool->mutex);
+
+    if (released > 0) {
+        ESP_LOGI(TAG, "📉 %s pool released %d idle slab(s), now %d slabs", pool->name, released, (int)pool->slab_count);
+    }
+    return released;
+}
+
+// Slow path: detach a batch under the mutex (growing the pool if every slab is
+// full), keep one block for the caller and stash the rest in this core's magazine.
+static memory_block_t* pool_refill_magazine(memory_pool_t* pool, pool_magazine_t* mag) {
+    memory_block_t* batch[POOL_MAGAZINE_SIZE + 1];
+    const size_t want = pool->magazine_batch + 1;
+    size_t n = 0;
+
+    if (!pool_lock(pool, pdMS_TO_TICKS(100))) {
+        __atomic_fetch_add(&pool->allocation_failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    // Blocks idling in the other core's magazine still count as free
+    if (!pool_pick_slab_locked(pool)) pool_reclaim_magazines_locked(pool);
+
+    while (n < want) {
+        pool_slab_t* slab = pool_pick_slab_locked(pool);
+        if (!slab) {
+            if (n > 0 || !pool_grow_locked(pool)) break;
+            continue;
+        }
+        batch[n++] = pool_slab_pop_locked(slab);
+    }
+    if (n == 0) __atomic_fetch_add(&pool->allocation_failures, 1, __ATOMIC_RELAXED);
+    pool_unlock(pool);
+
+    if (n == 0) {
+        ESP_LOGW(TAG, "🔴 %s pool exhausted! (%d/%d blocks used)", pool->name, (int)pool->allocated_blocks, (int)pool->block_count);
+        gpio_set_level(LED_POOL_FULL, 1);
+        return NULL;
+    }
+
+    size_t i = 1;
+    portENTER_CRITICAL(&mag->lock);
+    while (i < n && mag->count < pool->magazine_capacity) mag->blocks[mag->count++] = batch[i++];
+    portEXIT_CRITICAL(&mag->lock);
+
+    // Another task on this core refilled the magazine meanwhile; hand the surplus back
+    if (i < n && pool_lock(pool, portMAX_DELAY)) {
+        for (; i < n; i++) pool_return_block_locked(pool, batch[i]);
+        pool_unlock(pool);
+    }
+    return batch[0];
 }
 
 void* pool_malloc(memory_pool_t* pool) {
     if (!pool || !pool->mutex) return NULL;
 
-    uint64_t start_time = esp_timer_get_time();
-    void* result = NULL;
+    const pool_stamp_t start = pool_stamp();
+    pool_magazine_t* mag = &pool->magazines[xPortGetCoreID()];
+    memory_block_t* block = NULL;
 
-    if (xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        if (pool->free_list) {
-            memory_block_t* block = pool->free_list;
-            pool->free_list = block->next;
+    portENTER_CRITICAL(&mag->lock);
+    mag->allocs++;
+    if (mag->count > 0) {
+        block = mag->blocks[--mag->count];
+        mag->alloc_hits++;
+    }
+    portEXIT_CRITICAL(&mag->lock);
 
-            if (block->magic != POOL_MAGIC_FREE || block->pool_id != pool->pool_id) {
-                ESP_LOGE(TAG, "🚨 Corruption detected in %s pool block %p!", pool->name, block);
-                gpio_set_level(LED_POOL_ERROR, 1);
-                xSemaphoreGive(pool->mutex);
-                return NULL;
-            }
+    if (!block) block = pool_refill_magazine(pool, mag);
+    if (!block) {
+        pool_hist_since(&pool->hist_alloc, start, 1);
+        return NULL;
+    }
 
-            block->magic = POOL_MAGIC_ALLOC;
-            block->alloc_time = esp_timer_get_time();
-            block->next = NULL;
+    pool_slab_t* slab = pool_find_slab(block);
+    if (!slab || !pool_free_block_ok(pool, block)) {
+        ESP_LOGE(TAG, "🚨 Corruption detected in %s pool block %p!", pool->name, block);
+        gpio_set_level(LED_POOL_ERROR, 1);
+        return NULL;
+    }
 
-            pool->allocated_blocks++;
-            if (pool->allocated_blocks > pool->peak_usage) pool->peak_usage = pool->allocated_blocks;
-            pool->total_allocations++;
+    const size_t block_index = slab_block_index(pool, slab, block);
+    if (pool->layout == POOL_LAYOUT_HEADER) {
+        block->magic = POOL_MAGIC_ALLOC;
+        block->alloc_time = esp_timer_get_time();
+        block->next = NULL;
+    } else {
+        slab->alloc_times[block_index] = esp_timer_get_time();
+    }
+    pool_bitmap_set(slab, block_index);
 
-            const size_t header_size        = sizeof(memory_block_t);
-            const size_t aligned_block_size = align_up(pool->block_size, pool->alignment);
-            const size_t total_block_size   = header_size + aligned_block_size;
-            const size_t block_index = ((uint8_t*)block - (uint8_t*)pool->pool_memory) / total_block_size;
+    size_t used = __atomic_add_fetch(&pool->allocated_blocks, 1, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&pool->peak_usage, __ATOMIC_RELAXED);
+    while (used > peak &&
+           !__atomic_compare_exchange_n(&pool->peak_usage, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
 
-            if (block_index < pool->block_count) {
-                pool->usage_bitmap[block_index / 8] |= (1U << (block_index % 8));
-            }
+    void* result = (uint8_t*)block + pool->header_size;
+    ESP_LOGD(TAG, "🟢 %s pool: allocated block %p (index %d)", pool->name, result, (int)block_index);
 
-            result = (uint8_t*)block + header_size;
-            ESP_LOGD(TAG, "🟢 %s pool: allocated block %p (index %d)", pool->name, result, (int)block_index);
-        } else {
-            pool->allocation_failures++;
-            ESP_LOGW(TAG, "🔴 %s pool exhausted! (%d/%d blocks used)", pool->name, (int)pool->allocated_blocks, (int)pool->block_count);
-            gpio_set_level(LED_POOL_FULL, 1);
-        }
-        xSemaphoreGive(pool->mutex);
+    pool_hist_since(&pool->hist_alloc, start, 1);
+    return result;
+}
+
+// Flip a block's metadata to free; callers adjust allocated_blocks themselves
+FORCE_INLINE_ATTR void pool_block_set_free(memory_pool_t* pool, pool_slab_t* slab, memory_block_t* block, size_t block_index) {
+    if (pool->layout == POOL_LAYOUT_HEADER) block->magic = POOL_MAGIC_FREE;
+    else if (pool->canary) ((pool_free_node_t*)block)->canary = POOL_MAGIC_FREE;
+    pool_bitmap_clear(slab, block_index);
+}
+
+// Called at the point the block is committed back to the pool (magazine or free list)
+FORCE_INLINE_ATTR void pool_mark_free(memory_pool_t* pool, pool_slab_t* slab, memory_block_t* block, size_t block_index) {
+    pool_block_set_free(pool, slab, block, block_index);
+    __atomic_sub_fetch(&pool->allocated_blocks, 1, __ATOMIC_RELAXED);
+}
+
+// Validate a pointer handed to pool_free*: returns its block, or NULL (already logged)
+static memory_block_t* pool_check_free(memory_pool_t* pool, void* ptr, pool_slab_t** slab_out, size_t* index_out) {
+    memory_block_t* block = (memory_block_t*)((uint8_t*)ptr - pool->header_size);
+
+    // Owning slab and stride first, so a foreign pointer never has its "header" read
+    pool_slab_t* slab = pool_find_slab(block);
+    if (!slab || slab->pool != pool || ((uint8_t*)block - slab->memory) % pool->block_stride != 0) {
+        ESP_LOGE(TAG, "🚨 Block %p out of bounds for %s pool!", ptr, pool->name);
+        gpio_set_level(LED_POOL_ERROR, 1);
+        return NULL;
     }
 
-    pool->allocation_time_total += (esp_timer_get_time() - start_time);
-    return result;
+    const size_t block_index = slab_block_index(pool, slab, block);
+
+    if (pool->layout == POOL_LAYOUT_HEADER &&
+        (block->magic != POOL_MAGIC_ALLOC || block->pool_id != pool->pool_id)) {
+        ESP_LOGE(TAG, "🚨 Invalid block %p for %s pool! Magic: 0x%08X, Pool ID: %lu",
+                 ptr, pool->name, block->magic, (unsigned long)block->pool_id);
+        gpio_set_level(LED_POOL_ERROR, 1);
+        return NULL;
+    }
+    if (pool->layout == POOL_LAYOUT_HEADERLESS && !pool_bitmap_test(slab, block_index)) {
+        ESP_LOGE(TAG, "🚨 Double free of %p in %s pool (block %d not in use)!", ptr, pool->name, (int)block_index);
+        gpio_set_level(LED_POOL_ERROR, 1);
+        return NULL;
+    }
+
+    *slab_out = slab;
+    *index_out = block_index;
+    return block;
 }
 
 bool pool_free(memory_pool_t* pool, void* ptr) {
     if (!pool || !ptr || !pool->mutex) return false;
 
-    uint64_t start_time = esp_timer_get_time();
-    bool ok = false;
+    const pool_stamp_t start = pool_stamp();
+    pool_slab_t* slab;
+    size_t block_index;
+    memory_block_t* block = pool_check_free(pool, ptr, &slab, &block_index);
+    if (!block) return false;
+
+    // ISR reserve blocks go back to the lock-free stack, wherever they are freed from
+    if (slab == pool->isr_slab && block_index < pool->isr_reserve) {
+        pool_mark_free(pool, slab, block, block_index);
+        pool_isr_push(pool, block_index);
+        pool_hist_since(&pool->hist_free, start, 1);
+        return true;
+    }
 
-    if (xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        const size_t header_size = sizeof(memory_block_t);
-        memory_block_t* block = (memory_block_t*)((uint8_t*)ptr - header_size);
+    pool_magazine_t* mag = &pool->magazines[xPortGetCoreID()];
+    bool cached = false;
 
-        if (block->magic != POOL_MAGIC_ALLOC || block->pool_id != pool->pool_id) {
-            ESP_LOGE(TAG, "🚨 Invalid block %p for %s pool! Magic: 0x%08X, Pool ID: %lu",
-                     ptr, pool->name, block->magic, (unsigned long)block->pool_id);
-            gpio_set_level(LED_POOL_ERROR, 1);
-            xSemaphoreGive(pool->mutex);
+    portENTER_CRITICAL(&mag->lock);
+    mag->frees++;
+    if (mag->count < pool->magazine_capacity) {
+        pool_mark_free(pool, slab, block, block_index);
+        mag->blocks[mag->count++] = block;
+        mag->free_hits++;
+        cached = true;
+    }
+    portEXIT_CRITICAL(&mag->lock);
+
+    if (!cached) {
+        // Magazine full: spill this block plus a batch of cached ones in one lock round-trip
+        memory_block_t* spill[POOL_MAGAZINE_SIZE > 0 ? POOL_MAGAZINE_SIZE : 1];
+        uint32_t n = 0;
+        if (!pool_lock(pool, pdMS_TO_TICKS(100))) {
+            pool_hist_since(&pool->hist_free, start, 1);
             return false;
         }
 
-        const size_t aligned_block_size = align_up(pool->block_size, pool->alignment);
-        const size_t total_block_size   = header_size + aligned_block_size;
-
-        if ((uint8_t*)block >= (uint8_t*)pool->pool_memory &&
-            (uint8_t*)block < (uint8_t*)pool->pool_memory + (total_block_size * pool->block_count)) {
+        pool_mark_free(pool, slab, block, block_index);
+        pool_return_block_locked(pool, block);
 
-            const size_t block_index = ((uint8_t*)block - (uint8_t*)pool->pool_memory) / total_block_size;
+        portENTER_CRITICAL(&mag->lock);
+        while (n < pool->magazine_batch && mag->count > 0) spill[n++] = mag->blocks[--mag->count];
+        portEXIT_CRITICAL(&mag->lock);
+        for (uint32_t i = 0; i < n; i++) pool_return_block_locked(pool, spill[i]);
+        pool_unlock(pool);
+    }
 
-            if (block_index < pool->block_count) {
-                pool->usage_bitmap[block_index / 8] &= ~(1U << (block_index % 8));
-            }
+    ESP_LOGD(TAG, "🟢 %s pool: freed block %p (index %d)", pool->name, ptr, (int)block_index);
 
-            block->magic = POOL_MAGIC_FREE;
-            block->next = pool->free_list;
-            pool->free_list = block;
+    pool_hist_since(&pool->hist_free, start, 1);
+    return true;
+}
 
-            pool->allocated_blocks--;
-            pool->total_deallocations++;
-            ok = true;
+// ====== Batch API ======
+// Fill ptrs[0..n) with blocks: magazine first, then the rest detached in a
+// single pool->mutex round-trip. Returns how many were allocated; the unfilled
+// tail of ptrs is set to NULL.
+size_t pool_malloc_batch(memory_pool_t* pool, void** ptrs, size_t n) {
+    if (!pool || !ptrs || n == 0 || !pool->mutex) return 0;
+
+    const pool_stamp_t start = pool_stamp();
+    pool_magazine_t* mag = &pool->magazines[xPortGetCoreID()];
+    memory_block_t** blocks = (memory_block_t**)ptrs;
+    size_t got = 0;
+
+    portENTER_CRITICAL(&mag->lock);
+    mag->allocs += n;
+    while (got < n && mag->count > 0) blocks[got++] = mag->blocks[--mag->count];
+    mag->alloc_hits += got;
+    portEXIT_CRITICAL(&mag->lock);
+
+    if (got < n && pool_lock(pool, pdMS_TO_TICKS(100))) {
+        if (!pool_pick_slab_locked(pool)) pool_reclaim_magazines_locked(pool);
+        while (got < n) {
+            pool_slab_t* slab = pool_pick_slab_locked(pool);
+            if (!slab && !(slab = pool_grow_locked(pool))) break;
+            blocks[got++] = pool_slab_pop_locked(slab);
+        }
+        pool_unlock(pool);
+    }
+    if (got < n) {
+        // One failure per block not handed out, so allocs - failures stays exact
+        __atomic_fetch_add(&pool->allocation_failures, n - got, __ATOMIC_RELAXED);
+        ESP_LOGW(TAG, "🔴 %s pool: batch got %d/%d blocks", pool->name, (int)got, (int)n);
+    }
 
-            ESP_LOGD(TAG, "🟢 %s pool: freed block %p (index %d)", pool->name, ptr, (int)block_index);
-        } else {
-            ESP_LOGE(TAG, "🚨 Block %p out of bounds for %s pool!", ptr, pool->name);
+    // Stamp every block with one timestamp, then publish the count once
+    const uint64_t now = esp_timer_get_time();
+    size_t ok = 0;
+    for (size_t i = 0; i < got; i++) {
+        memory_block_t* block = blocks[i];
+        pool_slab_t* slab = pool_find_slab(block);
+        if (!slab || !pool_free_block_ok(pool, block)) {
+            ESP_LOGE(TAG, "🚨 Corruption detected in %s pool block %p!", pool->name, block);
             gpio_set_level(LED_POOL_ERROR, 1);
+            continue;
+        }
+        const size_t block_index = slab_block_index(pool, slab, block);
+        if (pool->layout == POOL_LAYOUT_HEADER) {
+            block->magic = POOL_MAGIC_ALLOC;
+            block->alloc_time = now;
+            block->next = NULL;
+        } else {
+            slab->alloc_times[block_index] = now;
+        }
+        pool_bitmap_set(slab, block_index);
+        ptrs[ok++] = (uint8_t*)block + pool->header_size;
+    }
+    for (size_t i = ok; i < n; i++) ptrs[i] = NULL;
+
+    if (ok > 0) {
+        size_t used = __atomic_add_fetch(&pool->allocated_blocks, ok, __ATOMIC_RELAXED);
+        size_t peak = __atomic_load_n(&pool->peak_usage, __ATOMIC_RELAXED);
+        while (used > peak &&
+               !__atomic_compare_exchange_n(&pool->peak_usage, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
         }
-        xSemaphoreGive(pool->mutex);
     }
 
-    pool->deallocation_time_total += (esp_timer_get_time() - start_time);
+    pool_hist_since(&pool->hist_alloc, start, n);
     return ok;
 }
 
+// Free ptrs[0..n) (NULL entries are skipped). Blocks refill this core's magazine
+// first; the rest go back to their slabs under one pool->mutex acquisition.
+// Returns how many were freed; invalid pointers are logged and left alone.
+size_t pool_free_batch(memory_pool_t* pool, void* const* ptrs, size_t n) {
+    if (!pool || !ptrs || n == 0 || !pool->mutex) return 0;
+
+    const pool_stamp_t start = pool_stamp();
+    memory_block_t* pending[POOL_BATCH_MAX];
+    size_t freed = 0;
+
+    for (size_t base = 0; base < n; base += POOL_BATCH_MAX) {
+        const size_t chunk = (n - base < POOL_BATCH_MAX) ? n - base : POOL_BATCH_MAX;
+        size_t count = 0, chunk_freed = 0;
+
+        for (size_t i = 0; i < chunk; i++) {
+            if (!ptrs[base + i]) continue;
+            pool_slab_t* slab;
+            size_t block_index;
+            memory_block_t* block = pool_check_free(pool, ptrs[base + i], &slab, &block_index);
+            if (!block) continue;
+            pool_block_set_free(pool, slab, block, block_index);
+            chunk_freed++;
+            if (slab == pool->isr_slab && block_index < pool->isr_reserve) pool_isr_push(pool, block_index);
+            else pending[count++] = block;
+        }
+        if (chunk_freed == 0) continue;
+        __atomic_sub_fetch(&pool->allocated_blocks, chunk_freed, __ATOMIC_RELAXED);
+        freed += chunk_freed;
+
+        pool_magazine_t* mag = &pool->magazines[xPortGetCoreID()];
+        size_t cached = 0;
+        portENTER_CRITICAL(&mag->lock);
+        mag->frees += chunk_freed;
+        while (cached < count && mag->count < pool->magazine_capacity) mag->blocks[mag->count++] = pending[cached++];
+        mag->free_hits += cached;
+        portEXIT_CRITICAL(&mag->lock);
+
+        if (cached < count) {
+            // Blocks are already marked free, so wait for the lock rather than leak them
+            pool_lock(pool, portMAX_DELAY);
+            for (size_t i = cached; i < count; i++) pool_return_block_locked(pool, pending[i]);
+            pool_unlock(pool);
+        }
+    }
+
+    if (freed > 0) pool_hist_since(&pool->hist_free, start, freed);
+    return freed;
+}
+
+// ====== ISR-safe API ======
+// Never blocks or logs: safe from ISRs and from tasks holding a spinlock.
+// Only the ISR reserve is used, so this returns NULL once the reserve is drained.
+void* IRAM_ATTR pool_malloc_from_isr(memory_pool_t* pool) {
+    if (!pool || pool->isr_reserve == 0) return NULL;
+
+    const uint32_t index = pool_isr_pop(pool);
+    if (index == POOL_ISR_NIL) {
+        __atomic_add_fetch(&pool->isr_failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    pool_slab_t* slab = pool->isr_slab;
+    memory_block_t* block = (memory_block_t*)(slab->memory + index * pool->block_stride);
+    if (pool->layout == POOL_LAYOUT_HEADER) {
+        block->magic = POOL_MAGIC_ALLOC;
+        block->alloc_time = esp_timer_get_time();
+        block->next = NULL;
+    } else {
+        slab->alloc_times[index] = esp_timer_get_time();
+    }
+    pool_bitmap_set(slab, index);
+
+    size_t used = __atomic_add_fetch(&pool->allocated_blocks, 1, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&pool->peak_usage, __ATOMIC_RELAXED);
+    while (used > peak &&
+           !__atomic_compare_exchange_n(&pool->peak_usage, &peak, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    __atomic_add_fetch(&pool->isr_allocs, 1, __ATOMIC_RELAXED);
+    return (uint8_t*)block + pool->header_size;
+}
+
+// Accepts only ISR reserve blocks; anything else must go through pool_free from a task
+bool IRAM_ATTR pool_free_from_isr(memory_pool_t* pool, void* ptr) {
+    if (!pool || !ptr || pool->isr_reserve == 0) return false;
+
+    pool_slab_t* slab = pool->isr_slab;
+    memory_block_t* block = (memory_block_t*)((uint8_t*)ptr - pool->header_size);
+    const uintptr_t offset = (uintptr_t)block - (uintptr_t)slab->memory;
+    if ((uintptr_t)block < (uintptr_t)slab->memory || offset % pool->block_stride != 0 ||
+        offset / pool->block_stride >= pool->isr_reserve) {
+        return false;
+    }
+
+    const size_t index = offset / pool->block_stride;
+    if (pool->layout == POOL_LAYOUT_HEADER ? (block->magic != POOL_MAGIC_ALLOC || block->pool_id != pool->pool_id)
+                                           : !pool_bitmap_test(slab, index)) {
+        return false;
+    }
+    pool_mark_free(pool, slab, block, index);
+    pool_isr_push(pool, index);
+    return true;
+}
+
+// ====== Typed object pools ======
+// Objects live in one array, so a handle resolves with a shift, a mask and one
+// generation compare, with no lock. Each slot's generation word carries
+// OBJ_GEN_LIVE while the object is allocated; freeing bumps the generation, so
+// every handle issued earlier for that slot stops resolving. A slot whose
+// generation would wrap is retired instead of reused, which keeps stale-handle
+// detection exact rather than probabilistic. Pools whose handles are short-lived
+// (e.g. only in flight through a queue) can set reuse_on_wrap instead.
+typedef uint32_t obj_handle_t;      // (generation << index_bits) | index, 0 is never valid
+typedef uint16_t obj_handle16_t;    // same layout, for pools created with handle_bits = 16
+
+typedef void (*obj_ctor_t)(void* obj, void* ctx);
+typedef void (*obj_dtor_t)(void* obj, void* ctx);
+
+#define OBJ_GEN_LIVE 0x80000000UL
+
+typedef struct {
+    const char* name;
+    size_t object_size;
+    uint16_t capacity;
+    uint8_t handle_bits;    // 16 or 32
+    obj_ctor_t ctor;        // optional, runs on allocate
+    obj_dtor_t dtor;        // optional, runs on free after the handle is invalidated
+    void* ctx;
+    bool reuse_on_wrap;     // restart at generation 1 instead of retiring the slot
+} obj_pool_config_t;
+
+typedef struct {
+    const char* name;
+    uint8_t* storage;
+    size_t stride;
+    uint16_t capacity;
+    uint8_t handle_bits;
+    uint8_t index_bits;
+    uint32_t index_mask;
+    uint32_t gen_max;
+    uint32_t* generations;  // per slot: generation | OBJ_GEN_LIVE while allocated
+    uint16_t* free_next;    // free-stack links (out of band)
+    uint32_t free_head;     // (ABA tag << 16) | index
+    obj_ctor_t ctor;
+    obj_dtor_t dtor;
+    void* ctx;
+    bool reuse_on_wrap;
+    // stats
+    uint32_t live;
+    uint32_t peak;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+    uint32_t stale_rejects; // lookups or frees with an out-of-date handle
+    uint32_t retired;       // slots taken out of use at generation wrap
+    uint32_t wraps;         // generation restarts (reuse_on_wrap pools)
+} obj_pool_t;
+
+bool obj_pool_init(obj_pool_t* pool, const obj_pool_config_t* config) {
+    memset(pool, 0, sizeof(*pool));
+    if (config->capacity == 0 || config->capacity > OBJ_POOL_MAX_OBJECTS ||
+        (config->handle_bits != 16 && config->handle_bits != 32)) {
+        ESP_LOGE(TAG, "❌ %s object pool: bad capacity/handle size", config->name);
+        return false;
+    }
+
+    uint8_t index_bits = 1;
+    while ((1UL << index_bits) < config->capacity) index_bits++;
+    const uint8_t gen_bits = config->handle_bits - index_bits;
+    if (gen_bits < OBJ_MIN_GEN_BITS) {
+        ESP_LOGE(TAG, "❌ %s object pool: %u objects leave only %u generation bits in a %u-bit handle",
+                 config->name, config->capacity, gen_bits, config->handle_bits);
+        return false;
+    }
+
+    pool->name        = config->name;
+    pool->stride      = align_up(config->object_size, sizeof(uint32_t));
+    pool->capacity    = config->capacity;
+    pool->handle_bits = config->handle_bits;
+    pool->index_bits  = index_bits;
+    pool->index_mask  = (1UL << index_bits) - 1;
+    pool->gen_max     = gen_bits >= 31 ? (OBJ_GEN_LIVE - 1) : ((1UL << gen_bits) - 1);
+    pool->ctor        = config->ctor;
+    pool->dtor        = config->dtor;
+    pool->ctx         = config->ctx;
+    pool->reuse_on_wrap = config->reuse_on_wrap;
+
+    pool->storage     = (uint8_t*)heap_caps_calloc(pool->capacity, pool->stride, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    pool->generations = (uint32_t*)heap_caps_malloc(pool->capacity * sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    pool->free_next   = (uint16_t*)heap_caps_malloc(pool->capacity * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!pool->storage || !pool->generations || !pool->free_next) {
+        ESP_LOGE(TAG, "❌ %s object pool: out of memory", config->name);
+        heap_caps_free(pool->storage);
+        heap_caps_free(pool->generations);
+        heap_caps_free(pool->free_next);
+        memset(pool, 0, sizeof(*pool));
+        return false;
+    }
+
+    pool->free_head = POOL_ISR_NIL;
+    for (int i = pool->capacity - 1; i >= 0; i--) {
+        pool->generations[i] = 1;   // generation 0 is never issued, so handle 0 stays invalid
+        index_stack_push(&pool->free_head, pool->free_next, i);
+    }
+
+    ESP_LOGI(TAG, "✅ Initialized %s object pool: %u × %u bytes, %u-bit handles (%u index + %u generation bits)",
+             pool->name, pool->capacity, (unsigned)pool->stride, pool->handle_bits, index_bits, gen_bits);
+    return true;
+}
+
+static inline void* obj_pool_slot(const obj_pool_t* pool, uint32_t index) {
+    return pool->storage + index * pool->stride;
+}
+
+obj_handle_t obj_pool_alloc(obj_pool_t* pool) {
+    const uint32_t index = index_stack_pop(&pool->free_head, pool->free_next);
+    if (index == POOL_ISR_NIL) {
+        __atomic_add_fetch(&pool->failures, 1, __ATOMIC_RELAXED);
+        return OBJ_HANDLE_NULL;
+    }
+
+    const uint32_t gen = __atomic_load_n(&pool->generations[index], __ATOMIC_RELAXED);
+    void* obj = obj_pool_slot(pool, index);
+    if (pool->ctor) pool->ctor(obj, pool->ctx);
+    else memset(obj, 0, pool->stride);
+    // Publish: the handle only resolves once the object is constructed
+    __atomic_store_n(&pool->generations[index], gen | OBJ_GEN_LIVE, __ATOMIC_RELEASE);
+
+    const uint32_t live = __atomic_add_fetch(&pool->live, 1, __ATOMIC_RELAXED);
+    uint32_t peak = __atomic_load_n(&pool->peak, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&pool->peak, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    __atomic_add_fetch(&pool->allocs, 1, __ATOMIC_RELAXED);
+    return (gen << pool->index_bits) | index;
+}
+
+// O(1), lock-free. Returns NULL for a stale, freed or malformed handle. The pointer
+// stays valid until the owner frees the handle; readers that do not own the object
+// should use obj_pool_read instead.
+void* obj_pool_get(obj_pool_t* pool, obj_handle_t handle) {
+    const uint32_t index = handle & pool->index_mask;
+    const uint32_t gen   = handle >> pool->index_bits;
+    if (index >= pool->capacity ||
+        __atomic_load_n(&pool->generations[index], __ATOMIC_ACQUIRE) != (gen | OBJ_GEN_LIVE)) {
+        __atomic_add_fetch(&pool->stale_rejects, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    return obj_pool_slot(pool, index);
+}
+
+// Copy the object out, then re-check the generation (seqlock style): a copy torn
+// by a concurrent free or reuse is detected and rejected.
+bool obj_pool_read(obj_pool_t* pool, obj_handle_t handle, void* out, size_t size) {
+    const void* obj = obj_pool_get(pool, handle);
+    if (!obj) return false;
+    memcpy(out, obj, size < pool->stride ? size : pool->stride);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    const uint32_t index = handle & pool->index_mask;
+    if (__atomic_load_n(&pool->generations[index], __ATOMIC_RELAXED) != ((handle >> pool->index_bits) | OBJ_GEN_LIVE)) {
+        __atomic_add_fetch(&pool->stale_rejects, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
+// Returns false for a stale handle or a double free; exactly one free of a handle wins
+bool obj_pool_free(obj_pool_t* pool, obj_handle_t handle) {
+    const uint32_t index = handle & pool->index_mask;
+    const uint32_t gen   = handle >> pool->index_bits;
+    if (index >= pool->capacity || gen == 0) {
+        __atomic_add_fetch(&pool->stale_rejects, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    uint32_t expected = gen | OBJ_GEN_LIVE;
+    // 0: retired, never issued again
+    const uint32_t next_gen = gen < pool->gen_max ? gen + 1 : (pool->reuse_on_wrap ? 1 : 0);
+    if (!__atomic_compare_exchange_n(&pool->generations[index], &expected, next_gen, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(&pool->stale_rejects, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    if (pool->dtor) pool->dtor(obj_pool_slot(pool, index), pool->ctx);
+    if (next_gen == 0) {
+        __atomic_add_fetch(&pool->retired, 1, __ATOMIC_RELAXED);
+    } else {
+        if (next_gen < gen) __atomic_add_fetch(&pool->wraps, 1, __ATOMIC_RELAXED);
+        index_stack_push(&pool->free_head, pool->free_next, index);
+    }
+
+    __atomic_sub_fetch(&pool->live, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pool->frees, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Type-safe wrappers: OBJ_POOL_TYPED(msg, my_msg_t) gives msg_get / msg_read
+#define OBJ_POOL_TYPED(prefix, type)                                                        \
+    static inline type* prefix##_get(obj_pool_t* pool, obj_handle_t handle) {              \
+        return (type*)obj_pool_get(pool, handle);                                          \
+    }                                                                                      \
+    static inline bool prefix##_read(obj_pool_t* pool, obj_handle_t handle, type* out) {   \
+        return obj_pool_read(pool, handle, out, sizeof(type));                             \
+    }
+
+// Example payload: a sensor message passed between tasks by 16-bit handle
+typedef struct {
+    uint32_t timestamp_ms;
+    uint16_t sensor_id;
+    uint16_t sample_count;
+    int16_t samples[OBJ_MSG_SAMPLES];
+    uint32_t checksum;
+} sensor_msg_t;
+
+OBJ_POOL_TYPED(sensor_msg, sensor_msg_t)
+
+static obj_pool_t sensor_msg_pool;
+static QueueHandle_t sensor_msg_queue = NULL;
+static uint32_t sensor_msg_bad_checksums = 0;
+static uint32_t sensor_msg_stale_escapes = 0;  // stale handle that still resolved (must stay 0)
+
+static uint32_t sensor_msg_checksum(const sensor_msg_t* msg) {
+    uint32_t sum = msg->timestamp_ms ^ ((uint32_t)msg->sensor_id << 16) ^ msg->sample_count;
+    for (int i = 0; i < OBJ_MSG_SAMPLES; i++) sum = (sum << 5) + sum + (uint16_t)msg->samples[i];
+    return sum;
+}
+
+static void sensor_msg_ctor(void* obj, void* ctx) {
+    memset(obj, 0, sizeof(sensor_msg_t));
+    ((sensor_msg_t*)obj)->timestamp_ms = (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void sensor_msg_dtor(void* obj, void* ctx) {
+    memset(obj, 0xDD, sizeof(sensor_msg_t));  // poison: a leftover raw pointer reads garbage
+}
+
+// Handles only live for one trip through the queue, far fewer than the 2047
+// reuses of a slot it takes to wrap 11 generation bits, so slots are recycled
+static const obj_pool_config_t sensor_msg_pool_config = {
+    "SensorMsg", sizeof(sensor_msg_t), OBJ_MSG_POOL_SIZE, 16, sensor_msg_ctor, sensor_msg_dtor, NULL, true
+};
+
+// ====== Size profiler / auto sizing ======
+static void pool_profile_reset(pool_profile_t* prof) {
+    memset(prof, 0, sizeof(pool_profile_t));
+    prof->magic = POOL_MAGIC_PROFILE;
+    prof->version = POOL_PROFILE_VERSION;
+}
+
+static void pool_profile_record(size_t size, bool exhausted) {
+    const size_t bin = size ? (size - 1) / POOL_PROFILE_BIN_BYTES : 0;
+    __atomic_add_fetch(&pool_profile.samples, 1, __ATOMIC_RELAXED);
+    if (bin >= POOL_PROFILE_BINS) {
+        __atomic_add_fetch(&pool_profile.oversize, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_add_fetch(&pool_profile.bins[bin], 1, __ATOMIC_RELAXED);
+    if (exhausted) __atomic_add_fetch(&pool_profile.exhausted[bin], 1, __ATOMIC_RELAXED);
+}
+
+// Load the stored profile and age it (halve every count) so new behaviour wins over time
+static bool pool_profile_load(void) {
+    nvs_handle_t nvs;
+    size_t len = sizeof(pool_profile_t);
+    bool ok = false;
+    if (nvs_open(POOL_PROFILE_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        ok = nvs_get_blob(nvs, POOL_PROFILE_NVS_KEY, &pool_profile, &len) == ESP_OK &&
+             len == sizeof(pool_profile_t) &&
+             pool_profile.magic == POOL_MAGIC_PROFILE && pool_profile.version == POOL_PROFILE_VERSION;
+        nvs_close(nvs);
+    }
+    if (!ok) {
+        pool_profile_reset(&pool_profile);
+        return false;
+    }
+
+    uint32_t samples = 0;
+    for (int b = 0; b < POOL_PROFILE_BINS; b++) {
+        pool_profile.bins[b] >>= 1;
+        pool_profile.exhausted[b] >>= 1;
+        samples += pool_profile.bins[b];
+    }
+    pool_profile.oversize >>= 1;
+    pool_profile.samples = samples + pool_profile.oversize;
+    return true;
+}
+
+bool pool_profile_save(void) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(POOL_PROFILE_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, POOL_PROFILE_NVS_KEY, &pool_profile, sizeof(pool_profile_t));
+        if (err == ESP_OK) err = nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ Could not save size profile: %s", esp_err_to_name(err));
+        return false;
+    }
+    ESP_LOGI(TAG, "💾 Size profile saved to NVS (%lu samples)", (unsigned long)pool_profile.samples);
+    return true;
+}
+
+// Turn a profile into POOL_COUNT size classes + block counts within `budget` bytes.
+// Class edges minimise the sampled internal fragmentation (optimal partition of the
+// size bins by DP); block counts follow sampled demand per class, as a stand-in
+// for concurrency. `out` must hold the default configs (names, caps, layout...).
+bool pool_profile_plan(const pool_profile_t* prof, size_t budget, pool_config_t* out) {
+    if (prof->samples < POOL_PROFILE_MIN_SAMPLES) return false;
+
+    int last = -1;
+    for (int b = 0; b < POOL_PROFILE_BINS; b++) {
+        if (prof->bins[b] || prof->exhausted[b]) last = b;
+    }
+    if (last < 0) return false;
+    if (last < POOL_COUNT - 1) last = POOL_COUNT - 1;
+    const int n = last + 1;
+
+    // Scratch: prefix sums, DP table, cut points (~14 KB worst case)
+    const size_t row = (size_t)n + 1;
+    uint64_t* cnt  = heap_caps_malloc(sizeof(uint64_t) * row * (2 + POOL_COUNT), MALLOC_CAP_DEFAULT | MALLOC_CAP_8BIT);
+    uint16_t* cut  = heap_caps_malloc(sizeof(uint16_t) * row * POOL_COUNT, MALLOC_CAP_DEFAULT | MALLOC_CAP_8BIT);
+    if (!cnt || !cut) {
+        heap_caps_free(cnt);
+        heap_caps_free(cut);
+        return false;
+    }
+    uint64_t* bytes = cnt + row;
+    uint64_t* dp    = bytes + row;   // dp[k * row + b]: best waste covering bins [0, b) with k+1 classes
+
+    cnt[0] = bytes[0] = 0;
+    for (int b = 0; b < n; b++) {
+        const uint64_t w = prof->bins[b] + (uint64_t)POOL_PROFILE_EXHAUST_WEIGHT * prof->exhausted[b];
+        cnt[b + 1]   = cnt[b] + w;
+        bytes[b + 1] = bytes[b] + w * (uint64_t)((b + 1) * POOL_PROFILE_BIN_BYTES);
+    }
+    // Waste of one class covering bins [a, b): every request rounds up to the class edge
+    #define CLASS_WASTE(a, b) ((uint64_t)(b) * POOL_PROFILE_BIN_BYTES * (cnt[b] - cnt[a]) - (bytes[b] - bytes[a]))
+
+    for (int b = 1; b <= n; b++) { dp[b] = CLASS_WASTE(0, b); cut[b] = 0; }
+    for (int k = 1; k < POOL_COUNT; k++) {
+        for (int b = k + 1; b <= n; b++) {
+            uint64_t best = UINT64_MAX;
+            int best_a = k;
+            for (int a = k; a < b; a++) {
+                const uint64_t c = dp[(k - 1) * row + a] + CLASS_WASTE(a, b);
+                if (c < best) { best = c; best_a = a; }
+            }
+            dp[k * row + b] = best;
+            cut[k * row + b] = (uint16_t)best_a;
+        }
+    }
+
+    // Walk the cuts back from the last bin
+    int end = n;
+    uint64_t demand[POOL_COUNT];
+    for (int k = POOL_COUNT - 1; k >= 0; k--) {
+        const int start = (k == 0) ? 0 : cut[k * row + end];
+        out[k].block_size = (size_t)end * POOL_PROFILE_BIN_BYTES;
+        demand[k] = cnt[end] - cnt[start];
+        end = start;
+    }
+    #undef CLASS_WASTE
+    heap_caps_free(cnt);
+    heap_caps_free(cut);
+
+    // Share the budget: count_i proportional to demand_i, scaled so Σ count·stride fits
+    size_t stride[POOL_COUNT];
+    uint64_t weighted = 0;
+    for (int k = 0; k < POOL_COUNT; k++) {
+        stride[k] = pool_config_stride(&out[k], NULL);
+        weighted += demand[k] * stride[k];
+    }
+    size_t used = 0;
+    for (int k = 0; k < POOL_COUNT; k++) {
+        size_t count = weighted ? (size_t)((uint64_t)budget * demand[k] / weighted) : POOL_PROFILE_MIN_BLOCKS;
+        if (count < POOL_PROFILE_MIN_BLOCKS) count = POOL_PROFILE_MIN_BLOCKS;
+        if (count > POOL_PROFILE_MAX_BLOCKS) count = POOL_PROFILE_MAX_BLOCKS;
+        out[k].block_count = count;
+        used += count * stride[k];
+    }
+    // The minimum counts may overshoot: trim the most expensive class first
+    while (used > budget) {
+        int worst = -1;
+        for (int k = 0; k < POOL_COUNT; k++) {
+            if (out[k].block_count > POOL_PROFILE_MIN_BLOCKS &&
+                (worst < 0 || out[k].block_count * stride[k] > out[worst].block_count * stride[worst])) worst = k;
+        }
+        if (worst < 0) break;
+        out[worst].block_count--;
+        used -= stride[worst];
+    }
+    return true;
+}
+
+// Log the layout the current profile would produce on the next boot
+static void pool_profile_report(void) {
+    pool_config_t plan[POOL_COUNT];
+    memcpy(plan, pool_configs, sizeof(plan));
+    if (!pool_profile_plan(&pool_profile, POOL_RAM_BUDGET, plan)) {
+        ESP_LOGI(TAG, "📐 Size profile: %lu samples (need %d to plan)",
+                 (unsigned long)pool_profile.samples, POOL_PROFILE_MIN_SAMPLES);
+        return;
+    }
+    ESP_LOGI(TAG, "📐 Size profile: %lu samples, %lu oversize → next boot layout:",
+             (unsigned long)pool_profile.samples, (unsigned long)pool_profile.oversize);
+    for (int k = 0; k < POOL_COUNT; k++) {
+        ESP_LOGI(TAG, "  %-6s %4d × %4d bytes (now %d × %d)", plan[k].name,
+                 (int)plan[k].block_count, (int)plan[k].block_size,
+                 (int)pool_active_configs[k].block_count, (int)pool_active_configs[k].block_size);
+    }
+}
+
+// ====== Buddy tier ======
+// One region reserved at boot, split in powers of two from 4 KB up to the region
+// size. Blocks carry no header: tags[] holds the order of every block start (one
+// byte per 4 KB), so free() finds the order and its buddy in O(1) and merges up
+// in O(log n). Worst case internal waste is just under half a block, and the
+// region never fragments the system heap.
+typedef struct buddy_free_node {
+    struct buddy_free_node* next;
+    struct buddy_free_node* prev;
+} buddy_free_node_t;
+
+typedef struct {
+    uint8_t* region;
+    size_t region_size;
+    uint8_t region_order;
+    buddy_free_node_t* free_lists[BUDDY_ORDERS];
+    uint8_t tags[BUDDY_MAX_BLOCKS];
+    uint32_t requested[BUDDY_MAX_BLOCKS];   // caller size per allocated block start
+    SemaphoreHandle_t mutex;
+    // stats
+    size_t bytes_in_use;        // buddy block bytes handed out
+    size_t bytes_requested;     // caller bytes (in_use - requested = internal waste)
+    size_t peak_in_use;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t splits;
+    uint32_t merges;
+    uint32_t failures;
+} buddy_tier_t;
+
+static buddy_tier_t buddy;
+
+static inline size_t buddy_block_index(size_t offset) { return offset >> BUDDY_MIN_ORDER; }
+
+static void buddy_list_push(uint8_t order, size_t offset) {
+    buddy_free_node_t* node = (buddy_free_node_t*)(buddy.region + offset);
+    buddy_free_node_t** head = &buddy.free_lists[order - BUDDY_MIN_ORDER];
+    node->prev = NULL;
+    node->next = *head;
+    if (*head) (*head)->prev = node;
+    *head = node;
+    buddy.tags[buddy_block_index(offset)] = order | BUDDY_TAG_FREE;
+}
+
+static void buddy_list_remove(uint8_t order, size_t offset) {
+    buddy_free_node_t* node = (buddy_free_node_t*)(buddy.region + offset);
+    if (node->prev) node->prev->next = node->next;
+    else buddy.free_lists[order - BUDDY_MIN_ORDER] = node->next;
+    if (node->next) node->next->prev = node->prev;
+    buddy.tags[buddy_block_index(offset)] = BUDDY_TAG_NONE;
+}
+
+bool buddy_init(void) {
+    memset(&buddy, 0, sizeof(buddy));
+    buddy.mutex = xSemaphoreCreateMutex();
+    if (!buddy.mutex) return false;
+
+    // Largest region that fits: try PSRAM first so internal DRAM stays for the pools
+    for (uint8_t order = BUDDY_MAX_ORDER; order >= BUDDY_MIN_ORDER && !buddy.region; order--) {
+        buddy.region = (uint8_t*)heap_caps_malloc((size_t)1 << order, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!buddy.region) buddy.region = (uint8_t*)heap_caps_malloc((size_t)1 << order, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (buddy.region) {
+            buddy.region_order = order;
+            buddy.region_size = (size_t)1 << order;
+        }
+    }
+    if (!buddy.region) {
+        ESP_LOGE(TAG, "❌ Buddy tier: no room for even a %d KB region", 1 << (BUDDY_MIN_ORDER - 10));
+        vSemaphoreDelete(buddy.mutex);
+        buddy.mutex = NULL;
+        return false;
+    }
+
+    memset(buddy.tags, BUDDY_TAG_NONE, sizeof(buddy.tags));
+    buddy_list_push(buddy.region_order, 0);
+    ESP_LOGI(TAG, "✅ Initialized buddy tier: %u KB region, blocks %d KB..%u KB%s",
+             (unsigned)(buddy.region_size / 1024), 1 << (BUDDY_MIN_ORDER - 10), (unsigned)(buddy.region_size / 1024),
+             buddy.region_order < BUDDY_MAX_ORDER ? " (reduced to fit)" : "");
+    return true;
+}
+
+static inline bool buddy_owns(const void* ptr) {
+    return buddy.region && (const uint8_t*)ptr >= buddy.region && (const uint8_t*)ptr < buddy.region + buddy.region_size;
+}
+
+void* buddy_malloc(size_t size) {
+    if (!buddy.region || size == 0 || size > buddy.region_size) return NULL;
+
+    uint8_t order = BUDDY_MIN_ORDER;
+    while (((size_t)1 << order) < size) order++;
+
+    if (xSemaphoreTake(buddy.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return NULL;
+
+    uint8_t found = order;
+    while (found <= buddy.region_order && !buddy.free_lists[found - BUDDY_MIN_ORDER]) found++;
+    if (found > buddy.region_order) {
+        buddy.failures++;
+        xSemaphoreGive(buddy.mutex);
+        return NULL;
+    }
+
+    const size_t offset = (uint8_t*)buddy.free_lists[found - BUDDY_MIN_ORDER] - buddy.region;
+    buddy_list_remove(found, offset);
+    // Split down, putting each upper half on its free list
+    while (found > order) {
+        found--;
+        buddy_list_push(found, offset + ((size_t)1 << found));
+        buddy.splits++;
+    }
+    buddy.tags[buddy_block_index(offset)] = order;
+    buddy.requested[buddy_block_index(offset)] = size;
+
+    buddy.bytes_in_use += (size_t)1 << order;
+    buddy.bytes_requested += size;
+    if (buddy.bytes_in_use > buddy.peak_in_use) buddy.peak_in_use = buddy.bytes_in_use;
+    buddy.allocs++;
+    xSemaphoreGive(buddy.mutex);
+    return buddy.region + offset;
+}
+
+bool buddy_free(void* ptr) {
+    if (!buddy_owns(ptr)) return false;
+    size_t offset = (uint8_t*)ptr - buddy.region;
+    if (offset & (((size_t)1 << BUDDY_MIN_ORDER) - 1)) return false;
+
+    if (xSemaphoreTake(buddy.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+
+    uint8_t order = buddy.tags[buddy_block_index(offset)];
+    if (order == BUDDY_TAG_NONE || (order & BUDDY_TAG_FREE)) {
+        xSemaphoreGive(buddy.mutex);
+        ESP_LOGE(TAG, "❌ Buddy: invalid or double free of %p", ptr);
+        gpio_set_level(LED_POOL_ERROR, 1);
+        return false;
+    }
+
+    buddy.bytes_in_use -= (size_t)1 << order;
+    buddy.bytes_requested -= buddy.requested[buddy_block_index(offset)];
+    buddy.frees++;
+
+    // Merge with the buddy while it is free and of the same order
+    while (order < buddy.region_order) {
+        const size_t buddy_offset = offset ^ ((size_t)1 << order);
+        if (buddy.tags[buddy_block_index(buddy_offset)] != (order | BUDDY_TAG_FREE)) break;
+        buddy_list_remove(order, buddy_offset);
+        buddy.tags[buddy_block_index(offset)] = BUDDY_TAG_NONE;
+        if (buddy_offset < offset) offset = buddy_offset;
+        order++;
+        buddy.merges++;
+    }
+    buddy_list_push(order, offset);
+    xSemaphoreGive(buddy.mutex);
+    return true;
+}
+
+// Largest block buddy_malloc could hand out right now
+size_t buddy_largest_free(void) {
+    size_t largest = 0;
+    if (!buddy.region || xSemaphoreTake(buddy.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return 0;
+    for (int k = buddy.region_order; k >= BUDDY_MIN_ORDER; k--) {
+        if (buddy.free_lists[k - BUDDY_MIN_ORDER]) { largest = (size_t)1 << k; break; }
+    }
+    xSemaphoreGive(buddy.mutex);
+    return largest;
+}
+
 // ====== Smart pool allocator ======
 void* smart_pool_malloc(size_t size) {
-    const size_t required_size = size + 16; // safety margin
+    const bool sampled = (__atomic_fetch_add(&pool_profile_tick, 1, __ATOMIC_RELAXED) % POOL_PROFILE_SAMPLE_RATE) == 0;
+    bool exhausted = false;
     for (int i = 0; i < POOL_COUNT; i++) {
-        if (required_size <= pools[i].block_size) {
+        // Block headers live outside block_size, so the request fits as-is
+        if (size <= pools[i].block_size) {
             void* ptr = pool_malloc(&pools[i]);
             if (ptr) {
-                gpio_set_level(pool_configs[i].led_pin, 1);
+                if (sampled) pool_profile_record(size, exhausted);
+                gpio_set_level(pool_active_configs[i].led_pin, 1);
                 vTaskDelay(pdMS_TO_TICKS(50));
-                gpio_set_level(pool_configs[i].led_pin, 0);
+                gpio_set_level(pool_active_configs[i].led_pin, 0);
                 ESP_LOGD(TAG, "🎯 Smart allocation: %d bytes from %s pool", (int)size, pools[i].name);
                 return ptr;
             }
+            exhausted = true;
         }
     }
+    if (sampled) pool_profile_record(size, exhausted);
+
+    // Too big for the pools, or every fitting pool is full: buddy tier before the heap
+    void* ptr = buddy_malloc(size);
+    if (ptr) {
+        ESP_LOGD(TAG, "🎯 Smart allocation: %d bytes from buddy tier", (int)size);
+        return ptr;
+    }
     ESP_LOGW(TAG, "⚠️ No suitable pool for %d bytes, falling back to heap", (int)size);
     return heap_caps_malloc(size, MALLOC_CAP_DEFAULT | MALLOC_CAP_8BIT);
 }
 
 bool smart_pool_free(void* ptr) {
     if (!ptr) return false;
-    for (int i = 0; i < POOL_COUNT; i++) {
-        if (pool_free(&pools[i], ptr)) return true;
-    }
+    memory_pool_t* owner = pool_find_owner(ptr);
+    if (owner) return pool_free(owner, ptr);
+    if (buddy_owns(ptr)) return buddy_free(ptr);
     ESP_LOGD(TAG, "🎯 Freeing %p from heap (not from pool)", ptr);
     heap_caps_free(ptr);
     return true;
@@ -305,22 +1715,56 @@ void print_pool_statistics(void) {
         memory_pool_t* pool = &pools[i];
         if (pool->mutex && xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
             ESP_LOGI(TAG, "\n%s Pool:", pool->name);
-            ESP_LOGI(TAG, "  Block Size:      %d bytes", (int)pool->block_size);
+            ESP_LOGI(TAG, "  Block Size:      %d bytes (+%d overhead, %s, align %d)", (int)pool->block_size,
+                     (int)(pool->block_stride - pool->block_size),
+                     pool->layout == POOL_LAYOUT_HEADER ? "header" : "header-less", (int)pool->alignment);
             ESP_LOGI(TAG, "  Total Blocks:    %d", (int)pool->block_count);
+            ESP_LOGI(TAG, "  Slabs:           %d/%d (grown %lu, released %lu)",
+                     (int)pool->slab_count, (int)pool->max_slabs,
+                     (unsigned long)pool->slabs_grown, (unsigned long)pool->slabs_released);
+            for (const pool_slab_t* slab = pool->slabs; slab && pool->slab_count > 1; slab = slab->next) {
+                ESP_LOGI(TAG, "    slab %p: %d/%d in use%s", slab->memory, (int)slab->in_use,
+                         (int)slab->block_count, slab->permanent ? " (permanent)" : "");
+            }
             ESP_LOGI(TAG, "  Used Blocks:     %d (%d%%)",
                      (int)pool->allocated_blocks,
                      (int)((pool->allocated_blocks * 100) / pool->block_count));
             ESP_LOGI(TAG, "  Peak Usage:      %d blocks", (int)pool->peak_usage);
-            ESP_LOGI(TAG, "  Allocations:     %llu", pool->total_allocations);
-            ESP_LOGI(TAG, "  Deallocations:   %llu", pool->total_deallocations);
+            uint32_t allocs = 0, frees = 0, hits = 0, cached = 0;
+            for (int c = 0; c < portNUM_PROCESSORS; c++) {
+                const pool_magazine_t* mag = &pool->magazines[c];
+                allocs += mag->allocs;
+                frees  += mag->frees;
+                hits   += mag->alloc_hits + mag->free_hits;
+                cached += mag->count;
+            }
+            const uint32_t ops = allocs + frees;
+            ESP_LOGI(TAG, "  Allocations:     %lu", (unsigned long)(allocs - pool->allocation_failures));
+            ESP_LOGI(TAG, "  Deallocations:   %lu", (unsigned long)frees);
             ESP_LOGI(TAG, "  Failures:        %lu", (unsigned long)pool->allocation_failures);
-            if (pool->total_allocations > 0) {
-                uint32_t avg_alloc_time = pool->allocation_time_total / pool->total_allocations;
-                ESP_LOGI(TAG, "  Avg Alloc Time:  %lu μs", (unsigned long)avg_alloc_time);
+            ESP_LOGI(TAG, "  Cached Blocks:   %lu (magazine %d/core)", (unsigned long)cached, (int)pool->magazine_capacity);
+            if (pool->isr_reserve > 0) {
+                int isr_used = 0;
+                for (size_t k = 0; k < pool->isr_reserve; k++) isr_used += pool_bitmap_test(pool->isr_slab, k);
+                ESP_LOGI(TAG, "  ISR Reserve:     %d/%d in use (allocs %lu, failures %lu)",
+                         isr_used, (int)pool->isr_reserve,
+                         (unsigned long)pool->isr_allocs, (unsigned long)pool->isr_failures);
+            }
+            if (ops > 0) {
+                ESP_LOGI(TAG, "  Magazine Hits:   %lu/%lu ops (%.1f%%)",
+                         (unsigned long)hits, (unsigned long)ops, 100.0f * hits / ops);
+                ESP_LOGI(TAG, "  Lock Acq/Op:     %.3f (%lu total)",
+                         (float)pool->lock_acquisitions / ops, (unsigned long)pool->lock_acquisitions);
             }
-            if (pool->total_deallocations > 0) {
-                uint32_t avg_dealloc_time = pool->deallocation_time_total / pool->total_deallocations;
-                ESP_LOGI(TAG, "  Avg Dealloc Time: %lu μs", (unsigned long)avg_dealloc_time);
+            if (pool->hist_alloc.count > 0) {
+                ESP_LOGI(TAG, "  Alloc Latency:   p50 ≤%lu, p99 ≤%lu cycles",
+                         (unsigned long)pool_hist_percentile(&pool->hist_alloc, 5000),
+                         (unsigned long)pool_hist_percentile(&pool->hist_alloc, 9900));
+            }
+            if (pool->hist_free.count > 0) {
+                ESP_LOGI(TAG, "  Free Latency:    p50 ≤%lu, p99 ≤%lu cycles",
+                         (unsigned long)pool_hist_percentile(&pool->hist_free, 5000),
+                         (unsigned long)pool_hist_percentile(&pool->hist_free, 9900));
             }
             xSemaphoreGive(pool->mutex);
         }
@@ -328,6 +1772,89 @@ void print_pool_statistics(void) {
     ESP_LOGI(TAG, "═══════════════════════════════════════");
 }
 
+static void print_hist_line(const char* label, const pool_hist_t* live) {
+    const pool_hist_t h = *live;   // snapshot; writers never block on us
+    if (h.count == 0) {
+        ESP_LOGI(TAG, "  %-10s (no samples)", label);
+        return;
+    }
+    const uint32_t p50 = pool_hist_percentile(&h, 5000);
+    const uint32_t p99 = pool_hist_percentile(&h, 9900);
+    const uint32_t p999 = pool_hist_percentile(&h, 9990);
+    ESP_LOGI(TAG, "  %-10s n=%-7lu p50≤%-6lu p99≤%-6lu p99.9≤%-7lu max=%lu (%.1f μs)%s",
+             label, (unsigned long)h.count, (unsigned long)p50, (unsigned long)p99, (unsigned long)p999,
+             (unsigned long)h.max, (float)h.max / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+             h.migrated ? " *" : "");
+
+    // Non-empty buckets as "2^k:count"
+    char line[160];
+    int len = 0;
+    for (int k = 0; k < POOL_HIST_BUCKETS && len < (int)sizeof(line) - 16; k++) {
+        if (h.buckets[k] == 0) continue;
+        len += snprintf(line + len, sizeof(line) - len, " 2^%d:%lu", k, (unsigned long)h.buckets[k]);
+    }
+    ESP_LOGI(TAG, "  %-10s%s", "", line);
+}
+
+void print_pool_latency(void) {
+    ESP_LOGI(TAG, "\n⏱️ ═══ POOL LATENCY (CPU cycles @ %d MHz) ═══", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    for (int i = 0; i < POOL_COUNT; i++) {
+        memory_pool_t* pool = &pools[i];
+        if (!pool->mutex) continue;
+        ESP_LOGI(TAG, "%s Pool:", pool->name);
+        print_hist_line("alloc", &pool->hist_alloc);
+        print_hist_line("free", &pool->hist_free);
+        print_hist_line("lock wait", &pool->hist_lock_wait);
+        print_hist_line("lock hold", &pool->hist_lock_hold);
+        const uint32_t migrated = pool->hist_alloc.migrated + pool->hist_free.migrated +
+                                  pool->hist_lock_wait.migrated + pool->hist_lock_hold.migrated;
+        if (migrated > 0) ESP_LOGI(TAG, "  * %lu samples dropped (task migrated cores)", (unsigned long)migrated);
+    }
+    ESP_LOGI(TAG, "═══════════════════════════════════════");
+}
+
+void print_object_pool_statistics(const obj_pool_t* pool) {
+    if (!pool->storage) return;
+    ESP_LOGI(TAG, "\n🔖 ═══ OBJECT POOL: %s ═══", pool->name);
+    ESP_LOGI(TAG, "Objects:       %lu/%u live (peak %lu), %u bytes each",
+             (unsigned long)pool->live, pool->capacity, (unsigned long)pool->peak, (unsigned)pool->stride);
+    ESP_LOGI(TAG, "Handle:        %u bits (%u index + %u generation) vs %u-bit pointer",
+             pool->handle_bits, pool->index_bits, pool->handle_bits - pool->index_bits, (unsigned)(sizeof(void*) * 8));
+    ESP_LOGI(TAG, "Alloc/Free:    %lu/%lu, %lu failures",
+             (unsigned long)pool->allocs, (unsigned long)pool->frees, (unsigned long)pool->failures);
+    ESP_LOGI(TAG, "Stale Handles: %lu rejected, %lu slots retired, %lu generation wraps",
+             (unsigned long)pool->stale_rejects, (unsigned long)pool->retired, (unsigned long)pool->wraps);
+    ESP_LOGI(TAG, "═══════════════════════════════════════");
+}
+
+void print_buddy_statistics(void) {
+    if (!buddy.region) return;
+    size_t free_blocks[BUDDY_ORDERS] = {0};
+    size_t in_use = 0, requested = 0, peak = 0;
+    uint32_t allocs = 0, frees = 0, splits = 0, merges = 0, failures = 0;
+    if (xSemaphoreTake(buddy.mutex, pdMS_TO_TICKS(100)) != pdTRUE) return;
+    for (int k = 0; k < BUDDY_ORDERS; k++) {
+        for (buddy_free_node_t* n = buddy.free_lists[k]; n; n = n->next) free_blocks[k]++;
+    }
+    in_use = buddy.bytes_in_use; requested = buddy.bytes_requested; peak = buddy.peak_in_use;
+    allocs = buddy.allocs; frees = buddy.frees; splits = buddy.splits; merges = buddy.merges; failures = buddy.failures;
+    xSemaphoreGive(buddy.mutex);
+
+    ESP_LOGI(TAG, "\n🧱 ═══ BUDDY TIER ═══");
+    ESP_LOGI(TAG, "Region:        %u KB, in use %u bytes (peak %u), largest free %u bytes",
+             (unsigned)(buddy.region_size / 1024), (unsigned)in_use, (unsigned)peak, (unsigned)buddy_largest_free());
+    ESP_LOGI(TAG, "Internal Waste: %u bytes (%.1f%% of in-use)", (unsigned)(in_use - requested),
+             in_use ? (float)(in_use - requested) * 100.0f / in_use : 0.0f);
+    for (int k = buddy.region_order; k >= BUDDY_MIN_ORDER; k--) {
+        if (free_blocks[k - BUDDY_MIN_ORDER]) {
+            ESP_LOGI(TAG, "  free %2u KB blocks: %u", (unsigned)(1U << (k - 10)), (unsigned)free_blocks[k - BUDDY_MIN_ORDER]);
+        }
+    }
+    ESP_LOGI(TAG, "Alloc/Free:    %lu/%lu, %lu splits, %lu merges, %lu failures",
+             (unsigned long)allocs, (unsigned long)frees, (unsigned long)splits, (unsigned long)merges, (unsigned long)failures);
+    ESP_LOGI(TAG, "═══════════════════════════════════════");
+}
+
 void visualize_pool_usage(void) {
     ESP_LOGI(TAG, "\n🎨 ═══ POOL USAGE VISUALIZATION ═══");
     for (int i = 0; i < POOL_COUNT; i++) {
@@ -347,36 +1874,255 @@ void visualize_pool_usage(void) {
 
 bool check_pool_integrity(void) {
     bool all_ok = true;
+    uint64_t max_stall = 0;
     ESP_LOGI(TAG, "\n🔍 ═══ POOL INTEGRITY CHECK ═══");
     for (int i = 0; i < POOL_COUNT; i++) {
         memory_pool_t* pool = &pools[i];
         bool pool_ok = true;
         if (pool->mutex && xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-            memory_block_t* current = pool->free_list;
+            const uint64_t locked_at = esp_timer_get_time();
             int free_count = 0;
-            while (current && free_count < pool->block_count) {
-                if (current->magic != POOL_MAGIC_FREE || current->pool_id != pool->pool_id) {
-                    ESP_LOGE(TAG, "❌ %s pool: Corrupted free block %p", pool->name, current);
+            for (pool_slab_t* slab = pool->slabs; pool_ok && slab; slab = slab->next) {
+                memory_block_t* current = slab->free_list;
+                int slab_free = 0;
+                while (current && slab_free < (int)slab->block_count) {
+                    if (!pool_free_block_ok(pool, current) || pool_find_slab(current) != slab) {
+                        ESP_LOGE(TAG, "❌ %s pool: Corrupted free block %p", pool->name, current);
+                        pool_ok = false; break;
+                    }
+                    current = current->next;
+                    slab_free++;
+                }
+                free_count += slab_free;
+            }
+            int cached_count = 0;
+            for (int c = 0; pool_ok && c < portNUM_PROCESSORS; c++) {
+                pool_magazine_t* mag = &pool->magazines[c];
+                memory_block_t* bad = NULL;
+                portENTER_CRITICAL(&mag->lock);
+                for (uint32_t k = 0; k < mag->count; k++) {
+                    if (!pool_free_block_ok(pool, mag->blocks[k])) {
+                        bad = mag->blocks[k]; break;
+                    }
+                }
+                cached_count += mag->count;
+                portEXIT_CRITICAL(&mag->lock);
+                if (bad) { ESP_LOGE(TAG, "❌ %s pool: Corrupted cached block %p (core %d)", pool->name, bad, c); pool_ok = false; }
+            }
+            // ISR reserve: the bitmap says which blocks are free, so no need to walk the live stack
+            int reserve_count = 0;
+            for (size_t k = 0; pool_ok && k < pool->isr_reserve; k++) {
+                if (pool_bitmap_test(pool->isr_slab, k)) continue;
+                memory_block_t* block = (memory_block_t*)(pool->isr_slab->memory + k * pool->block_stride);
+                if (!pool_free_block_ok(pool, block)) {
+                    ESP_LOGE(TAG, "❌ %s pool: Corrupted ISR reserve block %p", pool->name, block);
                     pool_ok = false; break;
                 }
-                current = current->next;
-                free_count++;
+                reserve_count++;
             }
-            if (pool_ok) ESP_LOGI(TAG, "✅ %s pool: %d free blocks verified", pool->name, free_count);
+            if (pool_ok) ESP_LOGI(TAG, "✅ %s pool: %d free + %d cached + %d ISR reserve blocks verified",
+                                  pool->name, free_count, cached_count, reserve_count);
+            const uint64_t held = esp_timer_get_time() - locked_at;
+            if (held > max_stall) max_stall = held;
             xSemaphoreGive(pool->mutex);
         }
         if (!pool_ok) { all_ok = false; gpio_set_level(LED_POOL_ERROR, 1); }
     }
     if (all_ok) { ESP_LOGI(TAG, "✅ All pools passed integrity check"); gpio_set_level(LED_POOL_ERROR, 0); }
+    ESP_LOGI(TAG, "Max allocator stall: %llu μs (full walk under each pool mutex)", (unsigned long long)max_stall);
     ESP_LOGI(TAG, "═══════════════════════════════════════");
     return all_ok;
 }
 
+// ====== Incremental integrity scanner ======
+// Walks every block of every slab a few at a time, holding pool->mutex only for
+// POOL_SCAN_SLICE_BLOCKS blocks, and cross-checks usage_bitmap against the block
+// magic (or the header-less canary). The magazine fast path updates magic and
+// bitmap without the mutex, so a mismatch is only reported if it is still there
+// on the next tick.
+typedef enum { SCAN_OK = 0, SCAN_SUSPECT, SCAN_CORRUPT } scan_result_t;
+
+typedef struct {
+    memory_pool_t* pool;
+    memory_block_t* block;
+} scan_suspect_t;
+
+typedef struct {
+    int pool;                   // cursor: pool index
+    int slab;                   // cursor: position in pool->slabs (slabs may come and go)
+    size_t block;               // cursor: next block in that slab
+    uint64_t sweep_start;
+    uint32_t sweep_blocks;
+    uint32_t last_sweep_ms;     // duration of the last full sweep
+    uint32_t last_sweep_blocks;
+    uint32_t sweeps;
+    uint32_t max_stall_us;      // longest single pool->mutex hold, since last report
+    uint32_t errors;
+    scan_suspect_t suspects[POOL_SCAN_SUSPECTS];
+    int suspect_count;
+    scan_suspect_t reported[POOL_SCAN_SUSPECTS];   // already logged, so each bad block is reported once
+    int reported_count;
+} pool_scan_state_t;
+
+static pool_scan_state_t pool_scan;
+static uint32_t pool_scan_budget_us = POOL_SCAN_BUDGET_US;
+
+void pool_scan_set_budget(uint32_t budget_us) {
+    pool_scan_budget_us = budget_us > 0 ? budget_us : 1;
+}
+
+static scan_result_t pool_scan_block(memory_pool_t* pool, pool_slab_t* slab, size_t index) {
+    const memory_block_t* block = (const memory_block_t*)(slab->memory + index * pool->block_stride);
+    const bool in_use = pool_bitmap_test(slab, index);
+    if (pool->layout == POOL_LAYOUT_HEADER) {
+        if ((block->magic != POOL_MAGIC_FREE && block->magic != POOL_MAGIC_ALLOC) || block->pool_id != pool->pool_id) {
+            return SCAN_CORRUPT;
+        }
+        return (in_use == (block->magic == POOL_MAGIC_ALLOC)) ? SCAN_OK : SCAN_SUSPECT;
+    }
+    // Header-less: payload of a used block is user data; a free one must keep its canary
+    if (!in_use && pool->canary && ((const pool_free_node_t*)block)->canary != POOL_MAGIC_FREE) return SCAN_SUSPECT;
+    return SCAN_OK;
+}
+
+static bool pool_scan_listed(const scan_suspect_t* list, int count, const memory_block_t* block) {
+    for (int i = 0; i < count; i++) {
+        if (list[i].block == block) return true;
+    }
+    return false;
+}
+
+static void pool_scan_report_error(memory_pool_t* pool, memory_block_t* block, scan_result_t r) {
+    if (pool_scan_listed(pool_scan.reported, pool_scan.reported_count, block)) return;
+    if (pool_scan.reported_count < POOL_SCAN_SUSPECTS) {
+        pool_scan.reported[pool_scan.reported_count].pool = pool;
+        pool_scan.reported[pool_scan.reported_count].block = block;
+        pool_scan.reported_count++;
+    }
+    pool_scan.errors++;
+    gpio_set_level(LED_POOL_ERROR, 1);
+    ESP_LOGE(TAG, "❌ Scanner: %s pool block %p %s", pool->name, block,
+             r == SCAN_CORRUPT ? "has a corrupted header" : "disagrees with usage_bitmap");
+}
+
+// Re-check last tick's mismatches; transients from the lock-free paths have settled by now
+static void pool_scan_confirm_suspects(void) {
+    const int count = pool_scan.suspect_count;
+    pool_scan.suspect_count = 0;
+    for (int i = 0; i < count; i++) {
+        memory_pool_t* pool = pool_scan.suspects[i].pool;
+        memory_block_t* block = pool_scan.suspects[i].block;
+        scan_result_t r = SCAN_OK;
+        if (xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(10)) != pdTRUE) continue;
+        pool_slab_t* slab = pool_find_slab(block);
+        if (slab && slab->pool == pool) r = pool_scan_block(pool, slab, slab_block_index(pool, slab, block));
+        xSemaphoreGive(pool->mutex);
+        if (r != SCAN_OK) pool_scan_report_error(pool, block, r);
+    }
+}
+
+// Scan for up to budget_us, one short mutex slice at a time
+void pool_scan_step(uint32_t budget_us) {
+    const uint64_t start = esp_timer_get_time();
+    if (pool_scan.sweep_start == 0) pool_scan.sweep_start = start;
+    pool_scan_confirm_suspects();
+
+    while (esp_timer_get_time() - start < budget_us) {
+        memory_pool_t* pool = &pools[pool_scan.pool];
+        bool next_pool = !pool->mutex;
+        struct { memory_block_t* block; scan_result_t r; } found[POOL_SCAN_SLICE_BLOCKS];
+        int found_count = 0;
+
+        if (!next_pool) {
+            if (xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(10)) != pdTRUE) break;
+            const uint64_t locked_at = esp_timer_get_time();
+
+            pool_slab_t* slab = pool->slabs;
+            for (int k = 0; slab && k < pool_scan.slab; k++) slab = slab->next;
+            if (!slab) {
+                next_pool = true;
+            } else {
+                for (int n = 0; n < POOL_SCAN_SLICE_BLOCKS && pool_scan.block < slab->block_count; n++) {
+                    const scan_result_t r = pool_scan_block(pool, slab, pool_scan.block);
+                    if (r != SCAN_OK) {
+                        found[found_count].block = (memory_block_t*)(slab->memory + pool_scan.block * pool->block_stride);
+                        found[found_count].r = r;
+                        found_count++;
+                    }
+                    pool_scan.block++;
+                    pool_scan.sweep_blocks++;
+                }
+                if (pool_scan.block >= slab->block_count) {
+                    pool_scan.slab++;
+                    pool_scan.block = 0;
+                }
+            }
+
+            const uint32_t held = (uint32_t)(esp_timer_get_time() - locked_at);
+            xSemaphoreGive(pool->mutex);
+            if (held > pool_scan.max_stall_us) pool_scan.max_stall_us = held;
+        }
+
+        // Log outside the mutex
+        for (int i = 0; i < found_count; i++) {
+            if (found[i].r == SCAN_CORRUPT) {
+                pool_scan_report_error(pool, found[i].block, found[i].r);
+            } else if (pool_scan.suspect_count < POOL_SCAN_SUSPECTS &&
+                       !pool_scan_listed(pool_scan.suspects, pool_scan.suspect_count, found[i].block)) {
+                pool_scan.suspects[pool_scan.suspect_count].pool = pool;
+                pool_scan.suspects[pool_scan.suspect_count].block = found[i].block;
+                pool_scan.suspect_count++;
+            }
+        }
+
+        if (next_pool) {
+            pool_scan.slab = 0;
+            pool_scan.block = 0;
+            if (++pool_scan.pool >= POOL_COUNT) {
+                const uint64_t now = esp_timer_get_time();
+                pool_scan.pool = 0;
+                pool_scan.last_sweep_ms = (uint32_t)((now - pool_scan.sweep_start) / 1000);
+                pool_scan.last_sweep_blocks = pool_scan.sweep_blocks;
+                pool_scan.sweep_blocks = 0;
+                pool_scan.sweep_start = now;
+                pool_scan.sweeps++;
+            }
+        }
+    }
+}
+
+void pool_scan_report(void) {
+    ESP_LOGI(TAG, "\n🔍 ═══ INCREMENTAL INTEGRITY SCAN ═══");
+    ESP_LOGI(TAG, "Budget:      %lu μs per %d ms tick, %d blocks per lock slice",
+             (unsigned long)pool_scan_budget_us, POOL_SCAN_TICK_MS, POOL_SCAN_SLICE_BLOCKS);
+    if (pool_scan.sweeps > 0) {
+        ESP_LOGI(TAG, "Full sweep:  %lu ms (%lu blocks), %lu sweeps so far",
+                 (unsigned long)pool_scan.last_sweep_ms, (unsigned long)pool_scan.last_sweep_blocks,
+                 (unsigned long)pool_scan.sweeps);
+    } else {
+        ESP_LOGI(TAG, "Full sweep:  in progress (%lu blocks so far)", (unsigned long)pool_scan.sweep_blocks);
+    }
+    ESP_LOGI(TAG, "Max allocator stall: %lu μs (since last report)", (unsigned long)pool_scan.max_stall_us);
+    if (pool_scan.errors == 0) ESP_LOGI(TAG, "✅ No corruption found");
+    else ESP_LOGE(TAG, "❌ %lu corrupted blocks found", (unsigned long)pool_scan.errors);
+    ESP_LOGI(TAG, "═══════════════════════════════════════");
+    pool_scan.max_stall_us = 0;
+}
+
+void pool_scan_task(void *pvParameters) {
+    ESP_LOGI(TAG, "🔍 Incremental integrity scanner started (%lu μs/tick)", (unsigned long)pool_scan_budget_us);
+    while (1) {
+        pool_scan_step(pool_scan_budget_us);
+        vTaskDelay(pdMS_TO_TICKS(POOL_SCAN_TICK_MS));
+    }
+}
+
 // ====== Test tasks ======
 void pool_stress_test_task(void *pvParameters) {
     ESP_LOGI(TAG, "🏋️ Pool stress test started");
-    void*  test_ptrs[100]  = {NULL};
-    size_t test_sizes[100] = {0};
+    void*    test_ptrs[100]  = {NULL};
+    size_t   test_sizes[100] = {0};
+    uint32_t test_sums[100]  = {0};     // mk_checksum of the fill pattern
     int allocation_count = 0;
 
     while (1) {
@@ -387,7 +2133,8 @@ void pool_stress_test_task(void *pvParameters) {
             test_ptrs[allocation_count] = smart_pool_malloc(size);
             if (test_ptrs[allocation_count]) {
                 test_sizes[allocation_count] = size;
-                memset(test_ptrs[allocation_count], 0xAA, size);
+                mk_fill(test_ptrs[allocation_count], 0xAA, size);
+                test_sums[allocation_count] = mk_checksum(test_ptrs[allocation_count], size);
                 allocation_count++;
                 ESP_LOGI(TAG, "🏋️ Allocated %d bytes (%d/100)", (int)size, allocation_count);
             }
@@ -395,12 +2142,12 @@ void pool_stress_test_task(void *pvParameters) {
         } else if (action == 1 && allocation_count > 0) {
             int index = esp_random() % allocation_count;
             if (test_ptrs[index]) {
-                uint8_t* data = (uint8_t*)test_ptrs[index];
-                bool pattern_ok = true;
-                for (size_t i = 0; i < test_sizes[index]; i++) { if (data[i] != 0xAA) { pattern_ok = false; break; } }
+                bool pattern_ok = mk_checksum(test_ptrs[index], test_sizes[index]) == test_sums[index];
                 if (!pattern_ok) { ESP_LOGE(TAG, "🚨 Data corruption detected in allocation %d!", index); gpio_set_level(LED_POOL_ERROR, 1); }
                 smart_pool_free(test_ptrs[index]);
-                for (int i = index; i < allocation_count - 1; i++) { test_ptrs[i] = test_ptrs[i + 1]; test_sizes[i] = test_sizes[i + 1]; }
+                for (int i = index; i < allocation_count - 1; i++) {
+                    test_ptrs[i] = test_ptrs[i + 1]; test_sizes[i] = test_sizes[i + 1]; test_sums[i] = test_sums[i + 1];
+                }
                 allocation_count--;
                 ESP_LOGI(TAG, "🗑️ Freed allocation (%d/100)", allocation_count);
             }
@@ -414,6 +2161,168 @@ void pool_stress_test_task(void *pvParameters) {
     }
 }
 
+// Old smart_pool_free ownership test: lock each pool and read the would-be header
+// (only meaningful for header-layout pools, hence the Medium pool in the benchmark)
+static memory_pool_t* pool_probe_owner_legacy(void* ptr) {
+    memory_pool_t* owner = NULL;
+    for (int i = 0; i < POOL_COUNT && !owner; i++) {
+        memory_pool_t* pool = &pools[i];
+        if (pool->layout != POOL_LAYOUT_HEADER) continue;
+        // The header is padded to the pool's alignment, so it is not always just before ptr
+        const memory_block_t* block = (const memory_block_t*)((uint8_t*)ptr - pool->header_size);
+        if (!pool->mutex || xSemaphoreTake(pool->mutex, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+        if (block->magic == POOL_MAGIC_ALLOC && block->pool_id == pool->pool_id) owner = pool;
+        xSemaphoreGive(pool->mutex);
+    }
+    return owner;
+}
+
+// Mixed pool/heap frees: per-pool probing vs. the address-range index
+void benchmark_mixed_free(void) {
+    static void* ptrs[MIXED_FREE_COUNT];
+    uint64_t probe_time = 0, index_time = 0;
+    int frees = 0;
+
+    for (int round = 0; round < MIXED_FREE_ROUNDS; round++) {
+        for (int pass = 0; pass < 2; pass++) {
+            // Even slots from the Medium pool, odd slots from the heap
+            for (int i = 0; i < MIXED_FREE_COUNT; i++) {
+                ptrs[i] = (i % 2 == 0) ? pool_malloc(&pools[POOL_MEDIUM])
+                                       : heap_caps_malloc(32, MALLOC_CAP_DEFAULT | MALLOC_CAP_8BIT);
+            }
+
+            uint64_t start = esp_timer_get_time();
+            for (int i = 0; i < MIXED_FREE_COUNT; i++) {
+                if (!ptrs[i]) continue;
+                memory_pool_t* owner = (pass == 0) ? pool_probe_owner_legacy(ptrs[i]) : pool_find_owner(ptrs[i]);
+                if (owner) pool_free(owner, ptrs[i]);
+                else heap_caps_free(ptrs[i]);
+                if (pass == 0) frees++;
+            }
+            uint64_t elapsed = esp_timer_get_time() - start;
+            if (pass == 0) probe_time += elapsed; else index_time += elapsed;
+        }
+    }
+
+    if (frees == 0) return;
+    ESP_LOGI(TAG, "\n🔎 Mixed pool/heap free (%d frees, 50%% heap):", frees);
+    ESP_LOGI(TAG, "Probe all pools: %llu μs (%.2f μs/free)", (unsigned long long)probe_time, (float)probe_time / frees);
+    ESP_LOGI(TAG, "Range index:     %llu μs (%.2f μs/free)", (unsigned long long)index_time, (float)index_time / frees);
+    if (index_time > 0) ESP_LOGI(TAG, "Speedup: %.2fx", (float)probe_time / (float)index_time);
+}
+
+// alloc+free pair cost: lock-free ISR reserve vs the regular task path (Small pool)
+void benchmark_isr_path(void) {
+    static portMUX_TYPE bench_mux = portMUX_INITIALIZER_UNLOCKED;
+    memory_pool_t* pool = &pools[POOL_SMALL];
+    uint32_t isr_cycles = 0, isr_max = 0, task_cycles = 0, task_max = 0;
+    int isr_pairs = 0, task_pairs = 0;
+
+    for (int i = 0; i < ISR_PATH_ROUNDS; i++) {
+        // Critical section stands in for interrupt context: no blocking allowed here
+        portENTER_CRITICAL(&bench_mux);
+        uint32_t c0 = esp_cpu_get_cycle_count();
+        void* p = pool_malloc_from_isr(pool);
+        bool ok = p && pool_free_from_isr(pool, p);
+        uint32_t dc = esp_cpu_get_cycle_count() - c0;
+        portEXIT_CRITICAL(&bench_mux);
+        if (ok) {
+            isr_cycles += dc; isr_pairs++;
+            if (dc > isr_max) isr_max = dc;
+        }
+
+        c0 = esp_cpu_get_cycle_count();
+        p = pool_malloc(pool);
+        ok = p && pool_free(pool, p);
+        dc = esp_cpu_get_cycle_count() - c0;
+        if (ok) {
+            task_cycles += dc; task_pairs++;
+            if (dc > task_max) task_max = dc;
+        }
+    }
+
+    ESP_LOGI(TAG, "\n⚡ ISR-safe path (%s pool, alloc+free pairs):", pool->name);
+    if (isr_pairs > 0)
+        ESP_LOGI(TAG, "from_isr:    %lu cycles/pair avg, %lu max (%d pairs)",
+                 (unsigned long)(isr_cycles / isr_pairs), (unsigned long)isr_max, isr_pairs);
+    if (task_pairs > 0)
+        ESP_LOGI(TAG, "task path:   %lu cycles/pair avg, %lu max (%d pairs)",
+                 (unsigned long)(task_cycles / task_pairs), (unsigned long)task_max, task_pairs);
+}
+
+// Per-block alloc/free cost when POOL_BATCH_MAX blocks are moved in batches of 1..32
+void benchmark_batch_sizes(void) {
+    static void* ptrs[POOL_BATCH_MAX];
+    memory_pool_t* pool = &pools[POOL_SMALL];
+    const size_t batch_sizes[] = {1, 2, 4, 8, 16, 32};
+
+    ESP_LOGI(TAG, "\n📦 Batch alloc/free (%s pool, %d blocks × %d rounds):", pool->name, POOL_BATCH_MAX, BATCH_BENCH_ROUNDS);
+    for (int b = 0; b < (int)(sizeof(batch_sizes) / sizeof(batch_sizes[0])); b++) {
+        const size_t batch = batch_sizes[b];
+        uint64_t alloc_time = 0, free_time = 0;
+        size_t blocks = 0;
+
+        for (int round = 0; round <= BATCH_BENCH_ROUNDS; round++) {
+            uint64_t start = esp_timer_get_time();
+            size_t got = 0;
+            for (size_t off = 0; off < POOL_BATCH_MAX; off += batch) got += pool_malloc_batch(pool, &ptrs[off], batch);
+            uint64_t mid = esp_timer_get_time();
+            for (size_t off = 0; off < POOL_BATCH_MAX; off += batch) pool_free_batch(pool, &ptrs[off], batch);
+            uint64_t end = esp_timer_get_time();
+
+            if (round == 0) continue;   // warm-up (may grow the pool)
+            alloc_time += mid - start;
+            free_time  += end - mid;
+            blocks     += got;
+        }
+        if (blocks == 0) continue;
+        ESP_LOGI(TAG, "Batch %2d: alloc %.2f μs/block, free %.2f μs/block",
+                 (int)batch, (float)alloc_time / blocks, (float)free_time / blocks);
+    }
+}
+
+// memcpy and mk_copy throughput with src/dst aligned to exactly 4, 16 and 64 bytes
+void benchmark_alignment_memcpy(void) {
+    uint8_t* src_base = heap_caps_aligned_alloc(64, ALIGN_BENCH_BYTES + 64, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t* dst_base = heap_caps_aligned_alloc(64, ALIGN_BENCH_BYTES + 64, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!src_base || !dst_base) {
+        heap_caps_free(src_base);
+        heap_caps_free(dst_base);
+        return;
+    }
+    mk_fill(src_base, 0xA5, ALIGN_BENCH_BYTES + 64);
+
+    const size_t alignments[] = {4, 16, 64};
+    ESP_LOGI(TAG, "\n📐 memcpy / mk_copy throughput (%d bytes × %d rounds):", ALIGN_BENCH_BYTES, ALIGN_BENCH_ROUNDS);
+    for (int a = 0; a < 3; a++) {
+        // Offset from a 64-byte base gives exactly this alignment (not the next power up)
+        const size_t offset = alignments[a] == 64 ? 0 : alignments[a];
+        uint8_t* src = src_base + offset;
+        uint8_t* dst = dst_base + offset;
+
+        uint64_t start = esp_timer_get_time();
+        for (int r = 0; r < ALIGN_BENCH_ROUNDS; r++) {
+            memcpy(dst, src, ALIGN_BENCH_BYTES);
+            __asm__ __volatile__("" ::: "memory");   // keep every copy
+        }
+        uint64_t elapsed = esp_timer_get_time() - start;
+        if (elapsed == 0) elapsed = 1;
+
+        start = esp_timer_get_time();
+        for (int r = 0; r < ALIGN_BENCH_ROUNDS; r++) {
+            mk_copy(dst, src, ALIGN_BENCH_BYTES);
+            __asm__ __volatile__("" ::: "memory");
+        }
+        uint64_t elapsed_mk = esp_timer_get_time() - start;
+        if (elapsed_mk == 0) elapsed_mk = 1;
+        ESP_LOGI(TAG, "Align %2d: memcpy %llu μs (%.1f MB/s), mk_copy %llu μs (%.1f MB/s)", (int)alignments[a],
+                 (unsigned long long)elapsed, (float)ALIGN_BENCH_BYTES * ALIGN_BENCH_ROUNDS / elapsed,
+                 (unsigned long long)elapsed_mk, (float)ALIGN_BENCH_BYTES * ALIGN_BENCH_ROUNDS / elapsed_mk);
+    }
+    heap_caps_free(src_base);
+    heap_caps_free(dst_base);
+}
+
 void pool_performance_test_task(void *pvParameters) {
     ESP_LOGI(TAG, "⚡ Pool performance test started");
     const int test_iterations = 1000;
@@ -446,15 +2355,19 @@ void pool_performance_test_task(void *pvParameters) {
             uint64_t heap_free_time = esp_timer_get_time() - heap_free_start;
 
             ESP_LOGI(TAG, "\n📏 Size: %d bytes (%d iterations)", (int)test_size, test_iterations);
-            ESP_LOGI(TAG, "Pool Alloc:  %llu μs (%.2f μs/alloc)", pool_alloc_time, (float)pool_alloc_time / test_iterations);
-            ESP_LOGI(TAG, "Pool Free:   %llu μs (%.2f μs/free)",  pool_free_time, (float)pool_free_time / test_iterations);
-            ESP_LOGI(TAG, "Heap Alloc:  %llu μs (%.2f μs/alloc)", heap_alloc_time, (float)heap_alloc_time / test_iterations);
-            ESP_LOGI(TAG, "Heap Free:   %llu μs (%.2f μs/free)",  heap_free_time, (float)heap_free_time / test_iterations);
+            ESP_LOGI(TAG, "Pool Alloc:  %llu μs (%.2f μs/alloc)", (unsigned long long)pool_alloc_time, (float)pool_alloc_time / test_iterations);
+            ESP_LOGI(TAG, "Pool Free:   %llu μs (%.2f μs/free)",  (unsigned long long)pool_free_time, (float)pool_free_time / test_iterations);
+            ESP_LOGI(TAG, "Heap Alloc:  %llu μs (%.2f μs/alloc)", (unsigned long long)heap_alloc_time, (float)heap_alloc_time / test_iterations);
+            ESP_LOGI(TAG, "Heap Free:   %llu μs (%.2f μs/free)",  (unsigned long long)heap_free_time, (float)heap_free_time / test_iterations);
 
             float alloc_speedup = (float)heap_alloc_time / (float)pool_alloc_time;
             float free_speedup  = (float)heap_free_time  / (float)pool_free_time;
             ESP_LOGI(TAG, "Speedup: Alloc %.2fx, Free %.2fx", alloc_speedup, free_speedup);
         }
+        benchmark_mixed_free();
+        benchmark_isr_path();
+        benchmark_batch_sizes();
+        benchmark_alignment_memcpy();
         vTaskDelay(pdMS_TO_TICKS(30000)); // 30 s
     }
 }
@@ -504,19 +2417,158 @@ void pool_pattern_test_task(void *pvParameters) {
     }
 }
 
+// Producer: builds sensor messages in the object pool and queues 2-byte handles
+void object_pool_producer_task(void *pvParameters) {
+    ESP_LOGI(TAG, "🔖 Object pool producer started (queue item %u bytes vs %u-byte message)",
+             (unsigned)sizeof(obj_handle16_t), (unsigned)sizeof(sensor_msg_t));
+
+    // Self-test: stale lookups and double frees are rejected deterministically
+    obj_handle_t h = obj_pool_alloc(&sensor_msg_pool);
+    bool ok = h != OBJ_HANDLE_NULL && sensor_msg_get(&sensor_msg_pool, h) != NULL;
+    ok = ok && obj_pool_free(&sensor_msg_pool, h);
+    ok = ok && sensor_msg_get(&sensor_msg_pool, h) == NULL && !obj_pool_free(&sensor_msg_pool, h);
+    obj_handle_t h2 = obj_pool_alloc(&sensor_msg_pool);   // same slot, next generation
+    ok = ok && h2 != h && (h2 & sensor_msg_pool.index_mask) == (h & sensor_msg_pool.index_mask) &&
+         sensor_msg_get(&sensor_msg_pool, h) == NULL;
+    obj_pool_free(&sensor_msg_pool, h2);
+    if (ok) ESP_LOGI(TAG, "🔖 Handle self-test passed (0x%04lx -> 0x%04lx)", (unsigned long)h, (unsigned long)h2);
+    else { ESP_LOGE(TAG, "❌ Handle self-test failed"); gpio_set_level(LED_POOL_ERROR, 1); }
+
+    uint16_t sensor = 0;
+    while (1) {
+        obj_handle_t handle = obj_pool_alloc(&sensor_msg_pool);
+        if (handle == OBJ_HANDLE_NULL) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        sensor_msg_t* msg = sensor_msg_get(&sensor_msg_pool, handle);
+        msg->sensor_id = sensor++ % 8;
+        msg->sample_count = OBJ_MSG_SAMPLES;
+        for (int i = 0; i < OBJ_MSG_SAMPLES; i++) msg->samples[i] = (int16_t)(esp_random() & 0x0FFF);
+        msg->checksum = sensor_msg_checksum(msg);
+
+        obj_handle16_t wire = (obj_handle16_t)handle;
+        if (xQueueSend(sensor_msg_queue, &wire, pdMS_TO_TICKS(100)) != pdTRUE) {
+            obj_pool_free(&sensor_msg_pool, handle);
+        }
+        vTaskDelay(pdMS_TO_TICKS(20 + (esp_random() % 30)));
+    }
+}
+
+// Consumer: resolves handles, verifies the message, frees it, and periodically
+// checks that the previous (already freed) handle no longer resolves
+void object_pool_consumer_task(void *pvParameters) {
+    ESP_LOGI(TAG, "🔖 Object pool consumer started");
+    obj_handle_t last_freed = OBJ_HANDLE_NULL;
+    uint32_t received = 0;
+
+    while (1) {
+        obj_handle16_t wire;
+        if (xQueueReceive(sensor_msg_queue, &wire, portMAX_DELAY) != pdTRUE) continue;
+
+        sensor_msg_t* msg = sensor_msg_get(&sensor_msg_pool, wire);
+        if (!msg) continue;
+        if (msg->checksum != sensor_msg_checksum(msg)) {
+            sensor_msg_bad_checksums++;
+            ESP_LOGE(TAG, "🚨 Sensor message 0x%04x failed checksum", wire);
+            gpio_set_level(LED_POOL_ERROR, 1);
+        }
+        obj_pool_free(&sensor_msg_pool, wire);
+
+        if (++received % OBJ_STALE_PROBE_EVERY == 0 && last_freed != OBJ_HANDLE_NULL) {
+            sensor_msg_t copy;
+            if (sensor_msg_read(&sensor_msg_pool, last_freed, &copy) || obj_pool_free(&sensor_msg_pool, last_freed)) {
+                sensor_msg_stale_escapes++;
+                ESP_LOGE(TAG, "🚨 Stale handle 0x%04lx still resolved!", (unsigned long)last_freed);
+                gpio_set_level(LED_POOL_ERROR, 1);
+            }
+        }
+        last_freed = wire;
+    }
+}
+
+// Soak: random 4-16 KB allocations with random lifetimes, once straight from the
+// heap and once through smart_pool_malloc (buddy tier), tracking largest_8b
+void buddy_soak_task(void *pvParameters) {
+    ESP_LOGI(TAG, "🧱 Buddy soak benchmark started");
+    static const char* mode_names[2] = { "heap", "smart/buddy" };
+    struct { void* ptr; size_t size; } slots[BUDDY_SOAK_SLOTS];
+
+    vTaskDelay(pdMS_TO_TICKS(10000));
+    while (1) {
+        for (int mode = 0; mode < 2; mode++) {
+            memset(slots, 0, sizeof(slots));
+            const size_t before = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+            size_t min_largest = before;
+            uint32_t failures = 0, from_buddy = 0;
+
+            for (int op = 0; op < BUDDY_SOAK_OPS; op++) {
+                const int i = esp_random() % BUDDY_SOAK_SLOTS;
+                if (slots[i].ptr) {
+                    if (mode == 0) heap_caps_free(slots[i].ptr);
+                    else smart_pool_free(slots[i].ptr);
+                    slots[i].ptr = NULL;
+                } else {
+                    slots[i].size = BUDDY_SOAK_MIN_BYTES + esp_random() % (BUDDY_SOAK_MAX_BYTES - BUDDY_SOAK_MIN_BYTES);
+                    slots[i].ptr = (mode == 0) ? heap_caps_malloc(slots[i].size, MALLOC_CAP_8BIT) : smart_pool_malloc(slots[i].size);
+                    if (!slots[i].ptr) failures++;
+                    else if (buddy_owns(slots[i].ptr)) from_buddy++;
+                }
+                if (op % 20 == 0) {
+                    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+                    if (largest < min_largest) min_largest = largest;
+                }
+                vTaskDelay(pdMS_TO_TICKS(5));
+            }
+
+            const size_t with_live = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+            for (int i = 0; i < BUDDY_SOAK_SLOTS; i++) {
+                if (!slots[i].ptr) continue;
+                if (mode == 0) heap_caps_free(slots[i].ptr);
+                else smart_pool_free(slots[i].ptr);
+            }
+            const size_t after = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+            ESP_LOGI(TAG, "🧱 Soak [%s]: largest_8b before %u, min %u, with live set %u, after %u bytes",
+                     mode_names[mode], (unsigned)before, (unsigned)min_largest, (unsigned)with_live, (unsigned)after);
+            ESP_LOGI(TAG, "🧱 Soak [%s]: %d ops, %lu failures, %lu served by buddy tier",
+                     mode_names[mode], BUDDY_SOAK_OPS, (unsigned long)failures, (unsigned long)from_buddy);
+        }
+        vTaskDelay(pdMS_TO_TICKS(60000));
+    }
+}
+
 void pool_monitor_task(void *pvParameters) {
     ESP_LOGI(TAG, "📊 Pool monitor started");
+    int dumps = 0;
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(15000)); // Monitor every 15 seconds
         print_pool_statistics();
+        print_pool_latency();
+        print_object_pool_statistics(&sensor_msg_pool);
+        print_buddy_statistics();
+        dumps++;
+        if (POOL_HIST_RESET_EVERY > 0 && dumps % POOL_HIST_RESET_EVERY == 0) {
+            for (int i = 0; i < POOL_COUNT; i++) pool_reset_histograms(&pools[i]);
+            ESP_LOGI(TAG, "⏱️ Latency histograms reset (window = %d dumps)", POOL_HIST_RESET_EVERY);
+        }
+        if (dumps % POOL_PROFILE_SAVE_EVERY == 0) {
+            pool_profile_report();
+            pool_profile_save();
+        }
         visualize_pool_usage();
-        check_pool_integrity();
+        pool_scan_report();
+        // One full locked walk next to the first incremental report, to compare the stalls
+        if (dumps == 1) check_pool_integrity();
         bool any_exhausted = false;
         for (int i = 0; i < POOL_COUNT; i++) {
-            if (pools[i].allocated_blocks >= pools[i].block_count) { any_exhausted = true; break; }
+            pool_trim_idle_slabs(&pools[i]);
+            // A pool is only exhausted once it can no longer grow
+            if (pools[i].allocated_blocks >= pools[i].block_count &&
+                pools[i].slab_count >= pools[i].max_slabs) { any_exhausted = true; }
         }
         gpio_set_level(LED_POOL_FULL, any_exhausted ? 1 : 0);
-        ESP_LOGI(TAG, "System uptime: %llu ms", esp_timer_get_time() / 1000);
+        ESP_LOGI(TAG, "System uptime: %llu ms", (unsigned long long)(esp_timer_get_time() / 1000));
         ESP_LOGI(TAG, "Free heap: %d bytes\n", esp_get_free_heap_size());
     }
 }
@@ -538,12 +2590,32 @@ void app_main(void) {
     gpio_set_level(LED_POOL_FULL, 0);
     gpio_set_level(LED_POOL_ERROR, 0);
 
+    // NVS เก็บ size profile ข้ามการรีบูต
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Copy / fill / checksum kernels used by the tests; select them before any task starts
+    mk_init();
+
+    // Pool layout: stored profile if it has enough samples, otherwise the defaults
+    memcpy(pool_active_configs, pool_configs, sizeof(pool_active_configs));
+    if (pool_profile_load() && pool_profile_plan(&pool_profile, POOL_RAM_BUDGET, pool_active_configs)) {
+        ESP_LOGI(TAG, "📐 Pool layout from stored size profile (%lu samples)", (unsigned long)pool_profile.samples);
+    } else {
+        memcpy(pool_active_configs, pool_configs, sizeof(pool_active_configs));
+        ESP_LOGI(TAG, "📐 Pool layout from compile-time defaults");
+    }
+
     // Init pools (ไม่หยุดทั้งโปรแกรมถ้าบางพูลล้มเหลว)
     ESP_LOGI(TAG, "Initializing memory pools...");
     int ok_count = 0;
     for (int i = 0; i < POOL_COUNT; i++) {
-        if (init_memory_pool(&pools[i], &pool_configs[i], i + 1)) ok_count++;
-        else ESP_LOGW(TAG, "Skip %s pool (init failed).", pool_configs[i].name);
+        if (init_memory_pool(&pools[i], &pool_active_configs[i], i + 1)) ok_count++;
+        else ESP_LOGW(TAG, "Skip %s pool (init failed).", pool_active_configs[i].name);
     }
     if (ok_count == 0) {
         ESP_LOGE(TAG, "No pools initialized. Exiting.");
@@ -553,6 +2625,16 @@ void app_main(void) {
     pools_initialized = true;
     ESP_LOGI(TAG, "Initialized %d/%d pools successfully", ok_count, POOL_COUNT);
 
+    // Buddy tier for 4-64 KB requests (smart_pool_malloc falls back to heap without it)
+    bool buddy_ok = buddy_init();
+
+    // Typed object pool + handle queue
+    bool objects_ok = obj_pool_init(&sensor_msg_pool, &sensor_msg_pool_config);
+    if (objects_ok) {
+        sensor_msg_queue = xQueueCreate(OBJ_MSG_QUEUE_LEN, sizeof(obj_handle16_t));
+        objects_ok = sensor_msg_queue != NULL;
+    }
+
     print_pool_statistics();
 
     // Tasks
@@ -561,6 +2643,12 @@ void app_main(void) {
     xTaskCreate(pool_stress_test_task,     "StressTest",  3072, NULL, 5, NULL);
     xTaskCreate(pool_performance_test_task,"PerfTest",    3072, NULL, 4, NULL);
     xTaskCreate(pool_pattern_test_task,    "PatternTest", 3072, NULL, 5, NULL);
+    xTaskCreate(pool_scan_task,            "PoolScan",    3072, NULL, 3, NULL);
+    if (buddy_ok) xTaskCreate(buddy_soak_task, "BuddySoak", 3072, NULL, 3, NULL);
+    if (objects_ok) {
+        xTaskCreate(object_pool_producer_task, "ObjProducer", 3072, NULL, 4, NULL);
+        xTaskCreate(object_pool_consumer_task, "ObjConsumer", 3072, NULL, 4, NULL);
+    }
 
     ESP_LOGI(TAG, "All tasks created successfully");
 
@@ -572,18 +2660,29 @@ void app_main(void) {
     ESP_LOGI(TAG, "  GPIO19 - Pool Error/Corruption");
 
     ESP_LOGI(TAG, "\n🏊 Pool Configuration:");
-    ESP_LOGI(TAG, "  Small Pool:  %d × %d bytes = %d KB", SMALL_POOL_BLOCK_COUNT, SMALL_POOL_BLOCK_SIZE,  (SMALL_POOL_BLOCK_COUNT * SMALL_POOL_BLOCK_SIZE) / 1024);
-    ESP_LOGI(TAG, "  Medium Pool: %d × %d bytes = %d KB", MEDIUM_POOL_BLOCK_COUNT, MEDIUM_POOL_BLOCK_SIZE, (MEDIUM_POOL_BLOCK_COUNT * MEDIUM_POOL_BLOCK_SIZE) / 1024);
-    ESP_LOGI(TAG, "  Large Pool:  %d × %d bytes = %d KB", LARGE_POOL_BLOCK_COUNT,  LARGE_POOL_BLOCK_SIZE,  (LARGE_POOL_BLOCK_COUNT  * LARGE_POOL_BLOCK_SIZE)  / 1024);
-    ESP_LOGI(TAG, "  Huge Pool:   %d × %d bytes = %d KB", HUGE_POOL_BLOCK_COUNT,   HUGE_POOL_BLOCK_SIZE,   (HUGE_POOL_BLOCK_COUNT   * HUGE_POOL_BLOCK_SIZE)   / 1024);
+    for (int i = 0; i < POOL_COUNT; i++) {
+        const pool_config_t* cfg = &pool_active_configs[i];
+        ESP_LOGI(TAG, "  %-6s Pool: %d × %d bytes = %d KB", cfg->name, (int)cfg->block_count, (int)cfg->block_size,
+                 (int)(cfg->block_count * cfg->block_size) / 1024);
+    }
 
     ESP_LOGI(TAG, "\n🧪 Test Features:");
     ESP_LOGI(TAG, "  • Multi-tier Memory Pool System");
     ESP_LOGI(TAG, "  • Smart Pool Selection");
+    ESP_LOGI(TAG, "  • Per-core Magazine Caches");
+    ESP_LOGI(TAG, "  • Header-less Small Pool (out-of-band metadata)");
+    ESP_LOGI(TAG, "  • Growable Slab Pools (grow on exhaustion, release when idle)");
+    ESP_LOGI(TAG, "  • ISR-safe Allocation (lock-free reserve)");
+    ESP_LOGI(TAG, "  • Batch Allocate/Free (one lock per batch)");
+    ESP_LOGI(TAG, "  • Latency Histograms (p50/p99/p99.9, lock wait vs hold)");
+    ESP_LOGI(TAG, "  • Profile-guided Pool Sizing (NVS)");
+    ESP_LOGI(TAG, "  • Aligned / DMA-capable Pool Blocks");
+    ESP_LOGI(TAG, "  • Typed Object Pools (generation-checked 16-bit handles)");
+    ESP_LOGI(TAG, "  • Buddy Tier for 4-64 KB Requests (soak: largest_8b before/after)");
     ESP_LOGI(TAG, "  • Performance Benchmarking");
     ESP_LOGI(TAG, "  • Corruption Detection");
     ESP_LOGI(TAG, "  • Usage Visualization");
-    ESP_LOGI(TAG, "  • Integrity Checking");
+    ESP_LOGI(TAG, "  • Integrity Checking (incremental, time-budgeted)");
 
     ESP_LOGI(TAG, "Memory Pool System operational!");
 }
\ No newline at end of file
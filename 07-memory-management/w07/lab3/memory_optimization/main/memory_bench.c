@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_random.h"
+#include "memory_bench.h"
+
+static const char *TAG = "MEM_BENCH";
+
+// Sweep configuration
+#define MB_MIN_WORKING_SET   1024
+#define MB_MAX_WORKING_SET   (128 * 1024)
+#define MB_CHASE_NODE        32          // one node per cache line (ESP32 cache line = 32 B)
+#define MB_CHASE_STEPS       32768
+#define MB_BW_BYTES          (16 * 1024) // copy uses half as source, half as destination
+#define MB_BW_REPEAT         8
+#define MB_STRIDE_MAX        256
+#define MB_STRIDE_ACCESSES   16384
+#define MB_MAX_RESULTS       96
+
+// Every kernel uses aligned 32-bit loads and stores only: IRAM faults on 8/16-bit access
+typedef struct {
+    const char* name;
+    uint32_t caps;
+} mb_region_t;
+
+static const mb_region_t mb_regions[] = {
+    { "DRAM",  MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT },
+    { "IRAM",  MALLOC_CAP_EXEC | MALLOC_CAP_32BIT },
+    { "PSRAM", MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT },
+};
+
+typedef struct {
+    const char* region;
+    const char* test;           // latency, read, write, copy, stride
+    uint32_t bytes;             // working set (latency, bandwidth) or stride (stride)
+    float value;
+    const char* unit;
+} mb_result_t;
+
+static mb_result_t mb_results[MB_MAX_RESULTS];
+static int mb_result_count = 0;
+static volatile uint32_t mb_sink;   // keeps the loads from being optimised away
+
+static void mb_record(const char* region, const char* test, uint32_t bytes, float value, const char* unit) {
+    if (mb_result_count < MB_MAX_RESULTS) {
+        mb_results[mb_result_count++] = (mb_result_t){ region, test, bytes, value, unit };
+    }
+}
+
+static float mb_cycles_to_ns(uint32_t cycles) {
+    return cycles * 1000.0f / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+}
+
+// ====== Kernels (timed with the scheduler suspended) ======
+
+// Random cyclic permutation of the nodes (Sattolo), built before timing so the
+// chase measures memory, not the RNG. Each node holds the word index of the next.
+static void mb_build_chase(uint32_t* buf, size_t bytes) {
+    const uint32_t words_per_node = MB_CHASE_NODE / sizeof(uint32_t);
+    const uint32_t nodes = bytes / MB_CHASE_NODE;
+
+    for (uint32_t i = 0; i < nodes; i++) {
+        buf[i * words_per_node] = i;
+    }
+    for (uint32_t i = nodes - 1; i > 0; i--) {
+        const uint32_t j = esp_random() % i;
+        const uint32_t tmp = buf[i * words_per_node];
+        buf[i * words_per_node] = buf[j * words_per_node];
+        buf[j * words_per_node] = tmp;
+    }
+    // buf[] now holds a single cycle as a permutation of node numbers; store word indices
+    for (uint32_t i = 0; i < nodes; i++) {
+        buf[i * words_per_node] *= words_per_node;
+    }
+}
+
+static float mb_chase_ns(const uint32_t* buf) {
+    uint32_t p = 0;
+    vTaskSuspendAll();
+    const uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < MB_CHASE_STEPS; i++) {
+        p = buf[p];
+    }
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    xTaskResumeAll();
+    mb_sink = p;
+    return mb_cycles_to_ns(cycles) / MB_CHASE_STEPS;
+}
+
+static float mb_read_mbps(const uint32_t* buf, size_t bytes) {
+    const size_t words = bytes / sizeof(uint32_t);
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    vTaskSuspendAll();
+    const uint32_t start = esp_cpu_get_cycle_count();
+    for (int r = 0; r < MB_BW_REPEAT; r++) {
+        for (size_t i = 0; i < words; i += 4) {
+            s0 += buf[i]; s1 += buf[i + 1]; s2 += buf[i + 2]; s3 += buf[i + 3];
+        }
+    }
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    xTaskResumeAll();
+    mb_sink = s0 + s1 + s2 + s3;
+    return (float)bytes * MB_BW_REPEAT / mb_cycles_to_ns(cycles) * 1000.0f;   // bytes/ns → MB/s
+}
+
+static float mb_write_mbps(uint32_t* buf, size_t bytes) {
+    const size_t words = bytes / sizeof(uint32_t);
+    vTaskSuspendAll();
+    const uint32_t start = esp_cpu_get_cycle_count();
+    for (int r = 0; r < MB_BW_REPEAT; r++) {
+        for (size_t i = 0; i < words; i += 4) {
+            buf[i] = r; buf[i + 1] = r; buf[i + 2] = r; buf[i + 3] = r;
+        }
+    }
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    xTaskResumeAll();
+    return (float)bytes * MB_BW_REPEAT / mb_cycles_to_ns(cycles) * 1000.0f;
+}
+
+// Counts bytes copied (read + write traffic is twice that)
+static float mb_copy_mbps(uint32_t* dst, const uint32_t* src, size_t bytes) {
+    const size_t words = bytes / sizeof(uint32_t);
+    vTaskSuspendAll();
+    const uint32_t start = esp_cpu_get_cycle_count();
+    for (int r = 0; r < MB_BW_REPEAT; r++) {
+        for (size_t i = 0; i < words; i += 4) {
+            dst[i] = src[i]; dst[i + 1] = src[i + 1]; dst[i + 2] = src[i + 2]; dst[i + 3] = src[i + 3];
+        }
+    }
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    xTaskResumeAll();
+    return (float)bytes * MB_BW_REPEAT / mb_cycles_to_ns(cycles) * 1000.0f;
+}
+
+// bytes must be a power of 2; the index wraps inside the buffer
+static float mb_stride_ns(const uint32_t* buf, size_t bytes, uint32_t stride) {
+    const uint32_t mask = bytes / sizeof(uint32_t) - 1;
+    const uint32_t step = stride / sizeof(uint32_t);
+    uint32_t sum = 0, index = 0;
+    vTaskSuspendAll();
+    const uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < MB_STRIDE_ACCESSES; i++) {
+        sum += buf[index];
+        index = (index + step) & mask;
+    }
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    xTaskResumeAll();
+    mb_sink = sum;
+    return mb_cycles_to_ns(cycles) / MB_STRIDE_ACCESSES;
+}
+
+// ====== Suite ======
+static void mb_run_region(const mb_region_t* region) {
+    // Largest power-of-2 working set that fits twice in the region's largest block
+    size_t max_ws = MB_MAX_WORKING_SET;
+    while (max_ws >= MB_MIN_WORKING_SET && max_ws * 2 > heap_caps_get_largest_free_block(region->caps)) {
+        max_ws /= 2;
+    }
+    uint32_t* buf = max_ws >= MB_MIN_WORKING_SET ? heap_caps_malloc(max_ws, region->caps) : NULL;
+    if (!buf) {
+        ESP_LOGI(TAG, "%-5s: not available, skipped", region->name);
+        return;
+    }
+    for (size_t i = 0; i < max_ws / sizeof(uint32_t); i++) {
+        buf[i] = i;
+    }
+
+    ESP_LOGI(TAG, "%-5s: %p, working sets %d B .. %lu KB", region->name, buf, MB_MIN_WORKING_SET,
+             (unsigned long)(max_ws / 1024));
+
+    // Latency vs working set
+    for (size_t ws = MB_MIN_WORKING_SET; ws <= max_ws; ws *= 2) {
+        mb_build_chase(buf, ws);
+        mb_record(region->name, "latency", ws, mb_chase_ns(buf), "ns");
+    }
+
+    // Sequential bandwidth
+    const size_t bw_bytes = max_ws < MB_BW_BYTES ? max_ws : MB_BW_BYTES;
+    mb_record(region->name, "read", bw_bytes, mb_read_mbps(buf, bw_bytes), "MB/s");
+    mb_record(region->name, "write", bw_bytes, mb_write_mbps(buf, bw_bytes), "MB/s");
+    mb_record(region->name, "copy", bw_bytes / 2,
+              mb_copy_mbps(buf, buf + bw_bytes / 2 / sizeof(uint32_t), bw_bytes / 2), "MB/s");
+
+    // Stride sweep over the largest working set
+    for (uint32_t stride = sizeof(uint32_t); stride <= MB_STRIDE_MAX; stride *= 2) {
+        mb_record(region->name, "stride", stride, mb_stride_ns(buf, max_ws, stride), "ns");
+    }
+
+    heap_caps_free(buf);
+}
+
+static void mb_print_table(void) {
+    ESP_LOGI(TAG, "Region  Test      Bytes     Result");
+    for (int i = 0; i < mb_result_count; i++) {
+        const mb_result_t* r = &mb_results[i];
+        ESP_LOGI(TAG, "%-6s  %-8s  %7lu  %8.2f %s", r->region, r->test, (unsigned long)r->bytes, r->value, r->unit);
+    }
+}
+
+static void mb_print_json(void) {
+    printf("#MB-JSON {\"suite\": \"memory_hierarchy\", \"cpu_mhz\": %d, \"results\": [",
+           CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    for (int i = 0; i < mb_result_count; i++) {
+        const mb_result_t* r = &mb_results[i];
+        printf("%s{\"region\": \"%s\", \"test\": \"%s\", \"bytes\": %lu, \"value\": %.3f, \"unit\": \"%s\"}",
+               i ? ", " : "", r->region, r->test, (unsigned long)r->bytes, r->value, r->unit);
+    }
+    printf("]}\n");
+}
+
+void memory_hierarchy_benchmark(void) {
+    ESP_LOGI(TAG, "\n🏎️ ═══ MEMORY HIERARCHY BENCHMARK ═══");
+
+    mb_result_count = 0;
+    for (size_t i = 0; i < sizeof(mb_regions) / sizeof(mb_regions[0]); i++) {
+        mb_run_region(&mb_regions[i]);
+    }
+
+    mb_print_table();
+    mb_print_json();
+
+    ESP_LOGI(TAG, "═══════════════════════════════════════");
+}
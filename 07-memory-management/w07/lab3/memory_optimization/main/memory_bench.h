@@ -0,0 +1,8 @@
+// Memory-hierarchy benchmark: pointer-chase latency over random permutations,
+// sequential read/write/copy bandwidth, and stride / working-set sweeps for
+// internal DRAM, IRAM and PSRAM (when present).
+#pragma once
+
+// Runs the whole suite; prints a table per region and one "#MB-JSON {...}" line
+// for scripts. Takes a few seconds and suspends the scheduler while timing.
+void memory_hierarchy_benchmark(void);
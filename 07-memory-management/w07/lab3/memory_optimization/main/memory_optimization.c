@@ -14,6 +14,8 @@
 #include "driver/gpio.h"
 #include "soc/soc_memory_layout.h"
 #include "esp_random.h"
+#include "memory_bench.h"
+#include "mem_kernels.h"
 static const char *TAG = "MEM_OPT";
 
 // GPIO สำหรับแสดงสถานะ optimization
@@ -29,15 +31,44 @@ static const char *TAG = "MEM_OPT";
 #define IS_ALIGNED(ptr, align) (((uintptr_t)(ptr) & ((align) - 1)) == 0)
 
 // Static memory pools for optimization demonstration
-#define STATIC_BUFFER_SIZE   4096
-#define STATIC_BUFFER_COUNT  8
+// Size classes carved at link time; each class has at most 32 blocks so one
+// uint32_t occupancy word covers it
+#define STATIC_CLASS_COUNT   4
+#define STATIC_BUFFER_SIZE   4096        // largest class
+#define STATIC_BENCH_ITERATIONS 1000
+
+// Per-cycle scratch arenas (bump allocation on a static buffer)
+#define ARENA_DEFAULT_ALIGN  4
+#define ARENA_HEADROOM_PCT   25          // added to the high-water mark when sizing
+#define SCRATCH_ARENA_SIZE   1024
+#define SCRATCH_PERIOD_MS    10
+#define SCRATCH_REPORT_CYCLES 1000
 #define TASK_STACK_SIZE      2048
 #define MAX_TASKS            4
 
 // Static allocations
-static uint8_t static_buffers[STATIC_BUFFER_COUNT][STATIC_BUFFER_SIZE] __attribute__((aligned(4)));
-static bool static_buffer_used[STATIC_BUFFER_COUNT] = {false};
-static SemaphoreHandle_t static_buffer_mutex;
+static uint8_t static_arena_64[32 * 64] __attribute__((aligned(4)));
+static uint8_t static_arena_256[32 * 256] __attribute__((aligned(4)));
+static uint8_t static_arena_1k[8 * 1024] __attribute__((aligned(4)));
+static uint8_t static_arena_4k[8 * STATIC_BUFFER_SIZE] __attribute__((aligned(4)));
+
+typedef struct {
+    uint16_t block_size;
+    uint8_t count;                // <= 32
+    uint8_t* base;
+    uint32_t used;                // occupancy bitmap, bit i = block i (CAS only)
+    uint32_t allocations;
+    uint32_t spills;              // served here because the fitting class was full
+    uint32_t failures;
+    uint64_t requested_bytes;     // for internal waste: allocations * block_size - requested
+} static_class_t;
+
+static static_class_t static_classes[STATIC_CLASS_COUNT] = {
+    { .block_size =   64, .count = 32, .base = static_arena_64  },
+    { .block_size =  256, .count = 32, .base = static_arena_256 },
+    { .block_size = 1024, .count =  8, .base = static_arena_1k  },
+    { .block_size = STATIC_BUFFER_SIZE, .count = 8, .base = static_arena_4k },
+};
 
 // Static task stacks
 static StackType_t task_stacks[MAX_TASKS][TASK_STACK_SIZE] __attribute__((aligned(8)));
@@ -77,6 +108,20 @@ typedef struct {
     // 1 byte padding for alignment
 } __attribute__((aligned(8))) good_struct_t;
 
+// Scratch arena: owned by one task, so no locking. Everything allocated in a
+// cycle is dropped by arena_reset() (or back to a mark by arena_release())
+typedef struct {
+    const char* name;
+    uint8_t* base;               // static buffer from allocate_static_buffer()
+    size_t size;
+    size_t top;
+    size_t high_water;
+    uint32_t cycles;
+    uint32_t failures;
+} scratch_arena_t;
+
+typedef size_t arena_mark_t;
+
 // Memory region analysis
 typedef struct {
     const char* name;
@@ -88,59 +133,78 @@ typedef struct {
 } memory_region_info_t;
 
 // Static buffer management
-void* allocate_static_buffer(void) {
-    void* buffer = NULL;
-    
-    if (static_buffer_mutex && xSemaphoreTake(static_buffer_mutex, pdMS_TO_TICKS(100))) {
-        for (int i = 0; i < STATIC_BUFFER_COUNT; i++) {
-            if (!static_buffer_used[i]) {
-                static_buffer_used[i] = true;
-                buffer = static_buffers[i];
-                opt_stats.static_allocations++;
-                ESP_LOGD(TAG, "🟢 Static buffer %d allocated: %p", i, buffer);
-                gpio_set_level(LED_STATIC_ALLOC, 1);
-                break;
+// Claim the first zero bit with compare-and-swap; retries only when another
+// task changed the same word in between
+static void* static_class_claim(static_class_t* cls) {
+    const uint32_t all = cls->count == 32 ? UINT32_MAX : (1u << cls->count) - 1;
+    uint32_t used = __atomic_load_n(&cls->used, __ATOMIC_RELAXED);
+    
+    while (~used & all) {
+        const int bit = __builtin_ctz(~used & all);
+        if (__atomic_compare_exchange_n(&cls->used, &used, used | (1u << bit), true,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return cls->base + bit * cls->block_size;
+        }
+    }
+    return NULL;
+}
+
+// Smallest class that fits; spills to the next larger class when it is full
+void* allocate_static_buffer(size_t size) {
+    for (int c = 0; c < STATIC_CLASS_COUNT; c++) {
+        static_class_t* cls = &static_classes[c];
+        if (size > cls->block_size) continue;
+        
+        void* buffer = static_class_claim(cls);
+        if (buffer) {
+            __atomic_fetch_add(&cls->allocations, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&cls->requested_bytes, size, __ATOMIC_RELAXED);
+            if (c > 0 && size <= static_classes[c - 1].block_size) {
+                __atomic_fetch_add(&cls->spills, 1, __ATOMIC_RELAXED);
             }
+            __atomic_fetch_add(&opt_stats.static_allocations, 1, __ATOMIC_RELAXED);
+            ESP_LOGD(TAG, "🟢 Static %d-byte buffer allocated: %p", cls->block_size, buffer);
+            gpio_set_level(LED_STATIC_ALLOC, 1);
+            return buffer;
         }
-        xSemaphoreGive(static_buffer_mutex);
+        __atomic_fetch_add(&cls->failures, 1, __ATOMIC_RELAXED);
     }
-    
-    return buffer;
+    return NULL;
 }
 
 void free_static_buffer(void* buffer) {
-    if (!buffer || !static_buffer_mutex) return;
-    
-    if (xSemaphoreTake(static_buffer_mutex, pdMS_TO_TICKS(100))) {
-        for (int i = 0; i < STATIC_BUFFER_COUNT; i++) {
-            if (buffer == static_buffers[i] && static_buffer_used[i]) {
-                static_buffer_used[i] = false;
-                ESP_LOGD(TAG, "🗑️ Static buffer %d freed: %p", i, buffer);
-                break;
-            }
+    if (!buffer) return;
+    
+    for (int c = 0; c < STATIC_CLASS_COUNT; c++) {
+        static_class_t* cls = &static_classes[c];
+        const uintptr_t offset = (uintptr_t)buffer - (uintptr_t)cls->base;
+        if (offset >= (uintptr_t)cls->count * cls->block_size) continue;
+        
+        const uint32_t bit = 1u << (offset / cls->block_size);
+        if (offset % cls->block_size ||
+            !(__atomic_fetch_and(&cls->used, ~bit, __ATOMIC_RELEASE) & bit)) {
+            ESP_LOGW(TAG, "Invalid or double free of static buffer %p", buffer);
+            return;
         }
+        ESP_LOGD(TAG, "🗑️ Static %d-byte buffer freed: %p", cls->block_size, buffer);
         
-        // Check if any static buffers still in use
+        // LED off once no class has a buffer in use
         bool any_used = false;
-        for (int i = 0; i < STATIC_BUFFER_COUNT; i++) {
-            if (static_buffer_used[i]) {
-                any_used = true;
-                break;
-            }
+        for (int i = 0; i < STATIC_CLASS_COUNT; i++) {
+            any_used |= __atomic_load_n(&static_classes[i].used, __ATOMIC_RELAXED) != 0;
         }
-        
         if (!any_used) {
             gpio_set_level(LED_STATIC_ALLOC, 0);
         }
-        
-        xSemaphoreGive(static_buffer_mutex);
+        return;
     }
+    ESP_LOGW(TAG, "free_static_buffer: %p is not a static buffer", buffer);
 }
 
 // Memory alignment optimization
 void* aligned_malloc(size_t size, size_t alignment) {
     if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
-        ESP_LOGE(TAG, "Invalid alignment: %d (must be power of 2)", alignment);
+        ESP_LOGE(TAG, "Invalid alignment: %d (must be power of 2)", (int)alignment);
         return NULL;
     }
     
@@ -165,7 +229,7 @@ void* aligned_malloc(size_t size, size_t alignment) {
     opt_stats.dynamic_allocations++;
     
     ESP_LOGD(TAG, "🎯 Aligned malloc: %d bytes, %d-byte aligned at %p", 
-             size, alignment, aligned_ptr);
+             (int)size, (int)alignment, aligned_ptr);
     
     gpio_set_level(LED_ALIGNMENT_OPT, 1);
     vTaskDelay(pdMS_TO_TICKS(50));
@@ -185,6 +249,72 @@ void aligned_free(void* aligned_ptr) {
     free(orig_ptr);
 }
 
+// Scratch arenas
+bool arena_init(scratch_arena_t* arena, const char* name, size_t size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->name = name;
+    arena->base = allocate_static_buffer(size);
+    arena->size = size;
+    if (!arena->base) {
+        ESP_LOGE(TAG, "No static buffer for %d-byte arena %s", (int)size, name);
+        return false;
+    }
+    return true;
+}
+
+void arena_destroy(scratch_arena_t* arena) {
+    free_static_buffer(arena->base);
+    arena->base = NULL;
+}
+
+// Constant time: align the top, bump it. alignment must be a power of 2
+void* arena_alloc(scratch_arena_t* arena, size_t size, size_t alignment) {
+    const uintptr_t start = ALIGN_UP((uintptr_t)arena->base + arena->top, alignment);
+    const size_t top = start - (uintptr_t)arena->base + size;
+    
+    if (top > arena->size) {
+        arena->failures++;
+        ESP_LOGW(TAG, "Arena %s exhausted: %d + %d > %d bytes", arena->name, (int)arena->top, (int)size,
+                 (int)arena->size);
+        return NULL;
+    }
+    arena->top = top;
+    if (top > arena->high_water) arena->high_water = top;
+    return (void*)start;
+}
+
+arena_mark_t arena_mark(const scratch_arena_t* arena) {
+    return arena->top;
+}
+
+// Drop everything allocated after the mark
+void arena_release(scratch_arena_t* arena, arena_mark_t mark) {
+    if (mark <= arena->top) arena->top = mark;
+}
+
+// End of cycle
+void arena_reset(scratch_arena_t* arena) {
+    arena->top = 0;
+    arena->cycles++;
+}
+
+// High-water mark plus headroom, rounded up to the static class that holds it
+size_t arena_recommended_size(const scratch_arena_t* arena) {
+    const size_t wanted = arena->high_water + arena->high_water * ARENA_HEADROOM_PCT / 100;
+    for (int c = 0; c < STATIC_CLASS_COUNT; c++) {
+        if (wanted <= static_classes[c].block_size) return static_classes[c].block_size;
+    }
+    return ALIGN_UP(wanted, 64);
+}
+
+void print_arena_statistics(const scratch_arena_t* arena) {
+    const size_t recommended = arena_recommended_size(arena);
+    ESP_LOGI(TAG, "🧮 Arena %s: %lu cycles, high-water %d/%d bytes, %lu failures → recommend %d bytes%s",
+             arena->name, (unsigned long)arena->cycles, (int)arena->high_water, (int)arena->size,
+             (unsigned long)arena->failures, (int)recommended,
+             recommended < arena->size ? " (shrink)" : recommended > arena->size ? " (grow)" : "");
+}
+
 // Struct packing optimization demonstration
 void demonstrate_struct_optimization(void) {
     ESP_LOGI(TAG, "\n🏗️ ═══ STRUCT OPTIMIZATION DEMO ═══");
@@ -206,10 +336,10 @@ void demonstrate_struct_optimization(void) {
     good_example.d = 3.14159;
     good_example.e = 'E';
     
-    ESP_LOGI(TAG, "Bad struct size:  %d bytes", sizeof(bad_struct_t));
-    ESP_LOGI(TAG, "Good struct size: %d bytes", sizeof(good_struct_t));
+    ESP_LOGI(TAG, "Bad struct size:  %d bytes", (int)sizeof(bad_struct_t));
+    ESP_LOGI(TAG, "Good struct size: %d bytes", (int)sizeof(good_struct_t));
     ESP_LOGI(TAG, "Memory saved:     %d bytes per instance", 
-             sizeof(bad_struct_t) - sizeof(good_struct_t));
+             (int)(sizeof(bad_struct_t) - sizeof(good_struct_t)));
     
     // Calculate savings for arrays
     const int array_size = 1000;
@@ -218,10 +348,10 @@ void demonstrate_struct_optimization(void) {
     size_t array_savings = bad_array_size - good_array_size;
     
     ESP_LOGI(TAG, "Array of %d elements:", array_size);
-    ESP_LOGI(TAG, "  Bad alignment:  %d bytes", bad_array_size);
-    ESP_LOGI(TAG, "  Good alignment: %d bytes", good_array_size);
+    ESP_LOGI(TAG, "  Bad alignment:  %d bytes", (int)bad_array_size);
+    ESP_LOGI(TAG, "  Good alignment: %d bytes", (int)good_array_size);
     ESP_LOGI(TAG, "  Total saved:    %d bytes (%.1f KB)", 
-             array_savings, array_savings / 1024.0);
+             (int)array_savings, array_savings / 1024.0);
     
     opt_stats.packing_optimizations++;
     opt_stats.memory_saved_bytes += array_savings;
@@ -262,9 +392,9 @@ void analyze_memory_regions(void) {
             }
             
             ESP_LOGI(TAG, "%s:", region->name);
-            ESP_LOGI(TAG, "  Total:         %d bytes (%.1f KB)", total_size, total_size / 1024.0);
-            ESP_LOGI(TAG, "  Free:          %d bytes (%.1f KB)", free_size, free_size / 1024.0);
-            ESP_LOGI(TAG, "  Largest Block: %d bytes", largest_block);
+            ESP_LOGI(TAG, "  Total:         %d bytes (%.1f KB)", (int)total_size, total_size / 1024.0);
+            ESP_LOGI(TAG, "  Free:          %d bytes (%.1f KB)", (int)free_size, free_size / 1024.0);
+            ESP_LOGI(TAG, "  Largest Block: %d bytes", (int)largest_block);
             ESP_LOGI(TAG, "  Utilization:   %.1f%%", utilization);
             ESP_LOGI(TAG, "  Fragmentation: %.1f%%", fragmentation);
             ESP_LOGI(TAG, "  Executable:    %s", region->is_executable ? "Yes" : "No");
@@ -307,22 +437,31 @@ void optimize_memory_access_patterns(void) {
     
     uint64_t sequential_time = esp_timer_get_time() - start_time;
     
-    // Random access test
+    // Random access test: indices drawn before timing so only the loads are measured
+    uint16_t* random_index = malloc(array_size * sizeof(uint16_t));
+    if (!random_index) {
+        aligned_free(test_array);
+        return;
+    }
+    for (size_t i = 0; i < array_size; i++) {
+        random_index[i] = esp_random() % array_size;
+    }
+    
     start_time = esp_timer_get_time();
     sum = 0;
     
     for (int iter = 0; iter < iterations; iter++) {
         for (size_t i = 0; i < array_size; i++) {
-            size_t random_index = esp_random() % array_size;
-            sum += test_array[random_index];
+            sum += test_array[random_index[i]];
         }
     }
     
     uint64_t random_time = esp_timer_get_time() - start_time;
+    free(random_index);
     
     ESP_LOGI(TAG, "Access Pattern Performance (%d iterations):", iterations);
-    ESP_LOGI(TAG, "  Sequential: %llu μs", sequential_time);
-    ESP_LOGI(TAG, "  Random:     %llu μs", random_time);
+    ESP_LOGI(TAG, "  Sequential: %llu μs", (unsigned long long)sequential_time);
+    ESP_LOGI(TAG, "  Random:     %llu μs", (unsigned long long)random_time);
     ESP_LOGI(TAG, "  Speedup:    %.2fx (sequential vs random)", 
              (float)random_time / sequential_time);
     
@@ -333,6 +472,10 @@ void optimize_memory_access_patterns(void) {
     uint32_t* matrix = aligned_malloc(matrix_size * matrix_size * sizeof(uint32_t), 64);
     
     if (matrix) {
+        for (size_t i = 0; i < matrix_size * matrix_size; i++) {
+            matrix[i] = i;
+        }
+        
         // Row-major access (cache-friendly)
         start_time = esp_timer_get_time();
         sum = 0;
@@ -357,9 +500,9 @@ void optimize_memory_access_patterns(void) {
         
         uint64_t col_major_time = esp_timer_get_time() - start_time;
         
-        ESP_LOGI(TAG, "Matrix Access (%dx%d):", matrix_size, matrix_size);
-        ESP_LOGI(TAG, "  Row-major:    %llu μs (cache-friendly)", row_major_time);
-        ESP_LOGI(TAG, "  Column-major: %llu μs (cache-unfriendly)", col_major_time);
+        ESP_LOGI(TAG, "Matrix Access (%dx%d):", (int)matrix_size, (int)matrix_size);
+        ESP_LOGI(TAG, "  Row-major:    %llu μs (cache-friendly)", (unsigned long long)row_major_time);
+        ESP_LOGI(TAG, "  Column-major: %llu μs (cache-unfriendly)", (unsigned long long)col_major_time);
         ESP_LOGI(TAG, "  Performance:  %.2fx better with row-major", 
                  (float)col_major_time / row_major_time);
         
@@ -369,6 +512,60 @@ void optimize_memory_access_patterns(void) {
     ESP_LOGI(TAG, "═══════════════════════════════════════");
 }
 
+// Per-class cost and internal waste: a request just over the previous class
+// (worst case) and one that fills the block exactly
+void benchmark_static_classes(void) {
+    ESP_LOGI(TAG, "Static Size Classes (%d alloc+free each):", STATIC_BENCH_ITERATIONS);
+    ESP_LOGI(TAG, "  Class   Blocks  Request  ns/op   Waste");
+    
+    for (int c = 0; c < STATIC_CLASS_COUNT; c++) {
+        const static_class_t* cls = &static_classes[c];
+        const size_t requests[2] = { c > 0 ? static_classes[c - 1].block_size + 1 : 1, cls->block_size };
+        
+        for (int r = 0; r < 2; r++) {
+            // Other tasks may hold every block of the class: that would time spills/failures
+            if (__builtin_popcount(__atomic_load_n(&cls->used, __ATOMIC_RELAXED)) == cls->count) {
+                ESP_LOGI(TAG, "  %5d   %6d  %7d  class full, skipped",
+                         cls->block_size, cls->count, (int)requests[r]);
+                continue;
+            }
+            int done = 0;
+            uint64_t start_time = esp_timer_get_time();
+            for (; done < STATIC_BENCH_ITERATIONS; done++) {
+                void* buffer = allocate_static_buffer(requests[r]);
+                if (!buffer) break;
+                free_static_buffer(buffer);
+            }
+            uint64_t elapsed = esp_timer_get_time() - start_time;
+            if (done < STATIC_BENCH_ITERATIONS) {
+                ESP_LOGI(TAG, "  %5d   %6d  %7d  ran out of blocks, skipped",
+                         cls->block_size, cls->count, (int)requests[r]);
+                continue;
+            }
+            
+            ESP_LOGI(TAG, "  %5d   %6d  %7d  %5.0f  %5.1f%%",
+                     cls->block_size, cls->count, (int)requests[r],
+                     elapsed * 1000.0f / (STATIC_BENCH_ITERATIONS * 2),
+                     100.0f * (cls->block_size - requests[r]) / cls->block_size);
+        }
+    }
+    
+    ESP_LOGI(TAG, "  Single %d-byte class (old pool) for 256 bytes: %.1f%% waste",
+             STATIC_BUFFER_SIZE, 100.0f * (STATIC_BUFFER_SIZE - 256) / STATIC_BUFFER_SIZE);
+}
+
+void print_static_class_statistics(void) {
+    ESP_LOGI(TAG, "Static Classes:");
+    for (int c = 0; c < STATIC_CLASS_COUNT; c++) {
+        const static_class_t* cls = &static_classes[c];
+        const uint64_t granted = (uint64_t)cls->allocations * cls->block_size;
+        ESP_LOGI(TAG, "  %4d B: %2d/%2d in use, %lu allocs, %lu spills, %lu full, waste %.1f%%",
+                 cls->block_size, __builtin_popcount(cls->used), cls->count,
+                 (unsigned long)cls->allocations, (unsigned long)cls->spills, (unsigned long)cls->failures,
+                 granted ? 100.0f * (granted - cls->requested_bytes) / granted : 0.0f);
+    }
+}
+
 // Memory allocation benchmark
 void benchmark_allocation_strategies(void) {
     ESP_LOGI(TAG, "\n🏃 ═══ ALLOCATION BENCHMARK ═══");
@@ -393,7 +590,7 @@ void benchmark_allocation_strategies(void) {
     start_time = esp_timer_get_time();
     
     for (int i = 0; i < iterations; i++) {
-        void* ptr = allocate_static_buffer();
+        void* ptr = allocate_static_buffer(test_size);
         if (ptr) {
             memset(ptr, 0xFF, test_size);
             free_static_buffer(ptr);
@@ -402,11 +599,11 @@ void benchmark_allocation_strategies(void) {
     
     uint64_t static_time = esp_timer_get_time() - start_time;
     
-    ESP_LOGI(TAG, "Allocation Benchmark (%d iterations, %d bytes):", iterations, test_size);
+    ESP_LOGI(TAG, "Allocation Benchmark (%d iterations, %d bytes):", iterations, (int)test_size);
     ESP_LOGI(TAG, "  malloc/free: %llu μs (%.2f μs per operation)", 
-             malloc_time, (float)malloc_time / (iterations * 2));
+             (unsigned long long)malloc_time, (float)malloc_time / (iterations * 2));
     ESP_LOGI(TAG, "  static pool: %llu μs (%.2f μs per operation)", 
-             static_time, (float)static_time / (iterations * 2));
+             (unsigned long long)static_time, (float)static_time / (iterations * 2));
     
     if (static_time < malloc_time) {
         ESP_LOGI(TAG, "  Static is %.2fx faster!", (float)malloc_time / static_time);
@@ -439,8 +636,26 @@ void benchmark_allocation_strategies(void) {
     uint64_t aligned_time = esp_timer_get_time() - start_time;
     
     ESP_LOGI(TAG, "Alignment Benchmark:");
-    ESP_LOGI(TAG, "  Unaligned: %llu μs", unaligned_time);
-    ESP_LOGI(TAG, "  Aligned:   %llu μs", aligned_time);
+    ESP_LOGI(TAG, "  Unaligned: %llu μs", (unsigned long long)unaligned_time);
+    ESP_LOGI(TAG, "  Aligned:   %llu μs", (unsigned long long)aligned_time);
+    
+    // Benchmark 3: per-cycle scratch from a bump arena (one reset per cycle)
+    scratch_arena_t bench_arena;
+    if (arena_init(&bench_arena, "bench", STATIC_BUFFER_SIZE)) {
+        start_time = esp_timer_get_time();
+        for (int i = 0; i < iterations / 2; i++) {
+            void* ptr = arena_alloc(&bench_arena, test_size, 32);
+            if (ptr) {
+                memset(ptr, 0xAA, test_size);
+            }
+            arena_reset(&bench_arena);
+        }
+        uint64_t arena_time = esp_timer_get_time() - start_time;
+        arena_destroy(&bench_arena);
+        ESP_LOGI(TAG, "  Arena:     %llu μs (bump + reset, 32-byte aligned)", (unsigned long long)arena_time);
+    }
+    
+    benchmark_static_classes();
     
     ESP_LOGI(TAG, "═══════════════════════════════════════");
 }
@@ -477,6 +692,8 @@ BaseType_t create_static_task(TaskFunction_t task_function, const char* name,
 void optimization_test_task(void *pvParameters) {
     ESP_LOGI(TAG, "🧪 Optimization test task started");
     
+    memory_hierarchy_benchmark();
+    
     while (1) {
         gpio_set_level(LED_OPTIMIZATION, 1);
         
@@ -498,6 +715,49 @@ void optimization_test_task(void *pvParameters) {
     }
 }
 
+// Periodic loop with per-cycle scratch: a filter window for the whole cycle,
+// a variable-size temporary released back to a mark, and an output block
+void scratch_cycle_task(void *pvParameters) {
+    scratch_arena_t arena;
+    if (!arena_init(&arena, "Scratch", SCRATCH_ARENA_SIZE)) {
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "🧮 Scratch cycle task started (%d-byte arena, %d ms cycle)",
+             SCRATCH_ARENA_SIZE, SCRATCH_PERIOD_MS);
+    
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        float* window = arena_alloc(&arena, 32 * sizeof(float), 16);
+        for (int i = 0; window && i < 32; i++) {
+            window[i] = 1.0f / 32;
+        }
+        
+        arena_mark_t mark = arena_mark(&arena);
+        const size_t temp_count = 32 + esp_random() % 96;      // 128-508 bytes of floats
+        float* temp = arena_alloc(&arena, temp_count * sizeof(float), ARENA_DEFAULT_ALIGN);
+        float acc = 0;
+        if (window && temp) {
+            for (size_t i = 0; i < temp_count; i++) {
+                temp[i] = (float)i * 0.5f;
+                acc += temp[i] * window[i % 32];
+            }
+        }
+        arena_release(&arena, mark);
+        
+        int32_t* output = arena_alloc(&arena, 16 * sizeof(int32_t), ARENA_DEFAULT_ALIGN);
+        if (output) {
+            output[0] = (int32_t)acc;
+        }
+        
+        arena_reset(&arena);
+        if (arena.cycles % SCRATCH_REPORT_CYCLES == 0) {
+            print_arena_statistics(&arena);
+        }
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SCRATCH_PERIOD_MS));
+    }
+}
+
 void memory_usage_test_task(void *pvParameters) {
     ESP_LOGI(TAG, "📊 Memory usage test task started");
     
@@ -507,18 +767,21 @@ void memory_usage_test_task(void *pvParameters) {
         
         ESP_LOGI(TAG, "📊 Testing static buffer allocation...");
         for (int i = 0; i < 4; i++) {
-            static_buffers[i] = allocate_static_buffer();
+            static_buffers[i] = allocate_static_buffer(STATIC_BUFFER_SIZE);
             if (static_buffers[i]) {
                 ESP_LOGI(TAG, "  Allocated static buffer %d: %p", i, static_buffers[i]);
-                memset(static_buffers[i], 0x55, STATIC_BUFFER_SIZE);
+                mk_fill(static_buffers[i], 0x55, STATIC_BUFFER_SIZE);
             }
         }
         
         vTaskDelay(pdMS_TO_TICKS(5000));
         
-        // Free static buffers
+        // Free static buffers (checksum confirms the fill survived)
         for (int i = 0; i < 4; i++) {
             if (static_buffers[i]) {
+                if (mk_checksum(static_buffers[i], STATIC_BUFFER_SIZE) != (STATIC_BUFFER_SIZE / 4) * 0x55555555u) {
+                    ESP_LOGW(TAG, "  Static buffer %d corrupted", i);
+                }
                 free_static_buffer(static_buffers[i]);
                 ESP_LOGI(TAG, "  Freed static buffer %d", i);
             }
@@ -559,13 +822,14 @@ void optimization_monitor_task(void *pvParameters) {
         vTaskDelay(pdMS_TO_TICKS(15000)); // Monitor every 15 seconds
         
         ESP_LOGI(TAG, "\n📈 ═══ OPTIMIZATION STATISTICS ═══");
-        ESP_LOGI(TAG, "Static Allocations:      %d", opt_stats.static_allocations);
-        ESP_LOGI(TAG, "Dynamic Allocations:     %d", opt_stats.dynamic_allocations);
-        ESP_LOGI(TAG, "Alignment Optimizations: %d", opt_stats.alignment_optimizations);
-        ESP_LOGI(TAG, "Packing Optimizations:   %d", opt_stats.packing_optimizations);
+        ESP_LOGI(TAG, "Static Allocations:      %d", (int)opt_stats.static_allocations);
+        ESP_LOGI(TAG, "Dynamic Allocations:     %d", (int)opt_stats.dynamic_allocations);
+        ESP_LOGI(TAG, "Alignment Optimizations: %d", (int)opt_stats.alignment_optimizations);
+        ESP_LOGI(TAG, "Packing Optimizations:   %d", (int)opt_stats.packing_optimizations);
         ESP_LOGI(TAG, "Memory Saved:            %d bytes (%.1f KB)", 
-                 opt_stats.memory_saved_bytes, opt_stats.memory_saved_bytes / 1024.0);
-        ESP_LOGI(TAG, "Time Saved:              %llu μs", opt_stats.allocation_time_saved);
+                 (int)opt_stats.memory_saved_bytes, opt_stats.memory_saved_bytes / 1024.0);
+        ESP_LOGI(TAG, "Time Saved:              %llu μs", (unsigned long long)opt_stats.allocation_time_saved);
+        print_static_class_statistics();
         
         // Update LED based on savings
         if (opt_stats.memory_saved_bytes > 1024) {
@@ -579,7 +843,7 @@ void optimization_monitor_task(void *pvParameters) {
         ESP_LOGI(TAG, "  Free: %d bytes", esp_get_free_heap_size());
         ESP_LOGI(TAG, "  Min Free: %d bytes", esp_get_minimum_free_heap_size());
         
-        ESP_LOGI(TAG, "System uptime: %llu ms", esp_timer_get_time() / 1000);
+        ESP_LOGI(TAG, "System uptime: %llu ms", (unsigned long long)(esp_timer_get_time() / 1000));
         ESP_LOGI(TAG, "═══════════════════════════════════════\n");
     }
 }
@@ -601,15 +865,11 @@ void app_main(void) {
     gpio_set_level(LED_MEMORY_SAVING, 0);
     gpio_set_level(LED_OPTIMIZATION, 0);
     
-    // Create mutex for static buffer management
-    static_buffer_mutex = xSemaphoreCreateMutex();
-    if (!static_buffer_mutex) {
-        ESP_LOGE(TAG, "Failed to create static buffer mutex!");
-        return;
-    }
-    
     ESP_LOGI(TAG, "Static memory system initialized");
     
+    // Pick the copy/fill/checksum kernels for this chip
+    mk_init();
+    
     // Print initial memory analysis
     analyze_memory_regions();
     
@@ -617,12 +877,14 @@ void app_main(void) {
     demonstrate_struct_optimization();
     
     ESP_LOGI(TAG, "\n🏗️ ═══ STATIC ALLOCATION SETUP ═══");
-    ESP_LOGI(TAG, "Static buffers: %d × %d bytes = %d KB total",
-             STATIC_BUFFER_COUNT, STATIC_BUFFER_SIZE,
-             (STATIC_BUFFER_COUNT * STATIC_BUFFER_SIZE) / 1024);
+    for (int c = 0; c < STATIC_CLASS_COUNT; c++) {
+        ESP_LOGI(TAG, "Static buffers: %2d × %4d bytes = %2d KB",
+                 static_classes[c].count, static_classes[c].block_size,
+                 (static_classes[c].count * static_classes[c].block_size) / 1024);
+    }
     ESP_LOGI(TAG, "Task stacks: %d × %d bytes = %d KB total",
-             MAX_TASKS, TASK_STACK_SIZE * sizeof(StackType_t),
-             (MAX_TASKS * TASK_STACK_SIZE * sizeof(StackType_t)) / 1024);
+             MAX_TASKS, (int)(TASK_STACK_SIZE * sizeof(StackType_t)),
+             (int)((MAX_TASKS * TASK_STACK_SIZE * sizeof(StackType_t)) / 1024));
     ESP_LOGI(TAG, "═══════════════════════════════════════");
     
     // Create tasks using static allocation
@@ -631,6 +893,7 @@ void app_main(void) {
     // Use both static and dynamic task creation for demonstration
     create_static_task(optimization_test_task, "OptTest", 5, NULL);
     create_static_task(memory_usage_test_task, "MemUsage", 4, NULL);
+    create_static_task(scratch_cycle_task, "Scratch", 7, NULL);
     
     // Use regular dynamic allocation for monitor task
     xTaskCreate(optimization_monitor_task, "OptMonitor", 3072, NULL, 6, NULL);
@@ -649,7 +912,11 @@ void app_main(void) {
     ESP_LOGI(TAG, "  • Memory Alignment Optimization");
     ESP_LOGI(TAG, "  • Struct Packing Optimization");
     ESP_LOGI(TAG, "  • Memory Access Pattern Analysis");
+    ESP_LOGI(TAG, "  • Memory Hierarchy Benchmark (latency/bandwidth/stride, JSON)");
+    ESP_LOGI(TAG, "  • Self-tested Copy/Fill/Checksum Kernels with Runtime Dispatch");
     ESP_LOGI(TAG, "  • Allocation Performance Benchmarking");
+    ESP_LOGI(TAG, "  • Lock-free Static Size Classes (bitmap + CAS)");
+    ESP_LOGI(TAG, "  • Per-cycle Scratch Arenas (mark/release/reset)");
     ESP_LOGI(TAG, "  • Memory Region Analysis");
     
     ESP_LOGI(TAG, "Memory Optimization System operational!");
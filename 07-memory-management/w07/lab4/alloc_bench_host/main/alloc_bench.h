@@ -0,0 +1,34 @@
+// Allocator entry points the host benchmark drives. Each lab's source is
+// compiled unchanged in its own bench_*.c wrapper, which adds the setup its
+// app_main would normally do (without starting the lab's tasks).
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    const char* name;
+    bool (*init)(void);
+    void* (*alloc)(size_t size);
+    void (*free)(void* ptr);
+} bench_allocator_t;
+
+// heap_caps_malloc / heap_caps_free through the host shim (baseline)
+bool bench_heap_init(void);
+void* bench_heap_alloc(size_t size);
+void bench_heap_free(void* ptr);
+
+// memory_pools.c: pool_malloc on the smallest fitting pool, pool_free via the owner index
+bool bench_pools_init(void);
+void* bench_pools_alloc(size_t size);
+void bench_pools_free(void* ptr);
+
+// heap_management.c: tracked_malloc / tracked_free
+bool bench_tracked_init(void);
+void* bench_tracked_alloc(size_t size);
+void bench_tracked_free(void* ptr);
+
+// memory_optimization.c: allocate_static_buffer / free_static_buffer
+bool bench_static_init(void);
+void* bench_static_alloc(size_t size);
+void bench_static_free(void* ptr);
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "alloc_bench.h"
+
+static const char *TAG = "ALLOC_BENCH";
+
+// Sweep configuration
+#define BENCH_OPS_PER_THREAD    10000
+#define BENCH_SLOTS_PER_THREAD  32      // live allocations a worker may hold
+#define BENCH_MAX_THREADS       8
+#define BENCH_WORKER_PRIORITY   5       // equal priority: tick-driven time slicing between workers
+#define BENCH_RUNNER_PRIORITY   6
+#define BENCH_STACK_SIZE        4096
+#define BENCH_JSON_DEFAULT_PATH "alloc_bench_results.json"
+#define BENCH_JSON_ENV          "ALLOC_BENCH_JSON"
+
+static const int bench_thread_counts[] = { 1, 2, 4, 8 };
+static const int bench_alloc_percents[] = { 50, 67, 80 };   // share of ops that allocate
+
+// ====== Size distributions ======
+typedef struct {
+    const char* name;
+    size_t (*next_size)(void);
+} bench_size_dist_t;
+
+static size_t size_small(void) { return 16 + esp_random() % 241; }          // 16-256
+static size_t size_large(void) { return 1025 + esp_random() % 3072; }       // 1025-4096
+static size_t size_mixed(void) {
+    const uint32_t r = esp_random() % 100;
+    if (r < 80) return size_small();
+    if (r < 95) return 257 + esp_random() % 768;                            // 257-1024
+    return size_large();
+}
+
+static const bench_size_dist_t bench_dists[] = {
+    { "small", size_small },
+    { "mixed", size_mixed },
+    { "large", size_large },
+};
+
+// ====== Allocators under test ======
+bool bench_heap_init(void) { return true; }
+void* bench_heap_alloc(size_t size) { return heap_caps_malloc(size, MALLOC_CAP_8BIT); }
+void bench_heap_free(void* ptr) { heap_caps_free(ptr); }
+
+static const bench_allocator_t bench_allocators[] = {
+    { "heap_caps",     bench_heap_init,    bench_heap_alloc,    bench_heap_free },
+    { "memory_pools",  bench_pools_init,   bench_pools_alloc,   bench_pools_free },
+    { "tracked",       bench_tracked_init, bench_tracked_alloc, bench_tracked_free },
+    { "static_buffer", bench_static_init,  bench_static_alloc,  bench_static_free },
+};
+
+#define BENCH_COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+// ====== Workers ======
+typedef struct {
+    const bench_allocator_t* allocator;
+    const bench_size_dist_t* dist;
+    int alloc_percent;
+    uint32_t* alloc_ns;         // one sample per successful alloc
+    uint32_t* free_ns;          // one sample per free
+    uint32_t alloc_count;
+    uint32_t free_count;
+    uint32_t failures;
+    SemaphoreHandle_t start;
+    SemaphoreHandle_t done;
+} bench_worker_t;
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_worker_task(void *pvParameters) {
+    bench_worker_t* w = (bench_worker_t*)pvParameters;
+    void* slots[BENCH_SLOTS_PER_THREAD] = { 0 };
+    int live = 0;
+
+    xSemaphoreTake(w->start, portMAX_DELAY);
+
+    for (int op = 0; op < BENCH_OPS_PER_THREAD; op++) {
+        bool do_alloc = (int)(esp_random() % 100) < w->alloc_percent;
+        if (live == 0) do_alloc = true;
+        if (live == BENCH_SLOTS_PER_THREAD) do_alloc = false;
+
+        if (do_alloc) {
+            int i = esp_random() % BENCH_SLOTS_PER_THREAD;
+            while (slots[i]) i = (i + 1) % BENCH_SLOTS_PER_THREAD;
+            const size_t size = w->dist->next_size();
+            const uint64_t t0 = bench_now_ns();
+            slots[i] = w->allocator->alloc(size);
+            const uint64_t t1 = bench_now_ns();
+            if (slots[i]) {
+                ((uint8_t*)slots[i])[0] = (uint8_t)op;  // touch the block like a real user would
+                w->alloc_ns[w->alloc_count++] = (uint32_t)(t1 - t0);
+                live++;
+            } else {
+                w->failures++;
+            }
+        } else {
+            int i = esp_random() % BENCH_SLOTS_PER_THREAD;
+            while (!slots[i]) i = (i + 1) % BENCH_SLOTS_PER_THREAD;
+            const uint64_t t0 = bench_now_ns();
+            w->allocator->free(slots[i]);
+            const uint64_t t1 = bench_now_ns();
+            w->free_ns[w->free_count++] = (uint32_t)(t1 - t0);
+            slots[i] = NULL;
+            live--;
+        }
+    }
+
+    // Leave the allocator empty for the next run (not timed)
+    for (int i = 0; i < BENCH_SLOTS_PER_THREAD; i++) {
+        if (slots[i]) w->allocator->free(slots[i]);
+    }
+    xSemaphoreGive(w->done);
+    vTaskDelete(NULL);
+}
+
+// ====== Results ======
+typedef struct {
+    uint32_t p50, p99, p999, max;
+} bench_latency_t;
+
+static int cmp_u32(const void* a, const void* b) {
+    const uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static bench_latency_t bench_percentiles(uint32_t* samples, size_t n) {
+    bench_latency_t l = { 0 };
+    if (n == 0) return l;
+    qsort(samples, n, sizeof(uint32_t), cmp_u32);
+    l.p50  = samples[(n - 1) * 500 / 1000];
+    l.p99  = samples[(n - 1) * 990 / 1000];
+    l.p999 = samples[(n - 1) * 999 / 1000];
+    l.max  = samples[n - 1];
+    return l;
+}
+
+static void json_latency(FILE* f, const char* name, const bench_latency_t* l) {
+    fprintf(f, "\"%s\": {\"p50\": %u, \"p99\": %u, \"p999\": %u, \"max\": %u}",
+            name, (unsigned)l->p50, (unsigned)l->p99, (unsigned)l->p999, (unsigned)l->max);
+}
+
+// One (allocator, threads, distribution, ratio) point; appends a JSON object to f
+static void bench_run(FILE* f, bool first, const bench_allocator_t* allocator, int threads,
+                      const bench_size_dist_t* dist, int alloc_percent) {
+    static bench_worker_t workers[BENCH_MAX_THREADS];
+    const size_t total = (size_t)threads * BENCH_OPS_PER_THREAD;
+    uint32_t* alloc_ns = (uint32_t*)malloc(total * sizeof(uint32_t));
+    uint32_t* free_ns = (uint32_t*)malloc(total * sizeof(uint32_t));
+    SemaphoreHandle_t start = xSemaphoreCreateCounting(threads, 0);
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(threads, 0);
+    if (!alloc_ns || !free_ns || !start || !done) {
+        ESP_LOGE(TAG, "Out of host memory for %d-thread run", threads);
+        exit(1);
+    }
+
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (bench_worker_t){
+            .allocator = allocator, .dist = dist, .alloc_percent = alloc_percent,
+            .alloc_ns = alloc_ns + t * BENCH_OPS_PER_THREAD, .free_ns = free_ns + t * BENCH_OPS_PER_THREAD,
+            .start = start, .done = done,
+        };
+    }
+
+    // All workers wait on the start gate so the clock covers only the measured ops
+    for (int t = 0; t < threads; t++) {
+        xTaskCreate(bench_worker_task, "BenchWorker", BENCH_STACK_SIZE, &workers[t], BENCH_WORKER_PRIORITY, NULL);
+    }
+    const uint64_t started = bench_now_ns();
+    for (int t = 0; t < threads; t++) xSemaphoreGive(start);
+    for (int t = 0; t < threads; t++) xSemaphoreTake(done, portMAX_DELAY);
+    const uint64_t wall_ns = bench_now_ns() - started;
+    vTaskDelay(1);  // let the workers finish vTaskDelete before their semaphores go
+    vSemaphoreDelete(start);
+    vSemaphoreDelete(done);
+
+    // Pack per-thread samples together, then take percentiles over all threads
+    size_t n_alloc = 0, n_free = 0;
+    uint32_t failures = 0;
+    for (int t = 0; t < threads; t++) {
+        memmove(alloc_ns + n_alloc, workers[t].alloc_ns, workers[t].alloc_count * sizeof(uint32_t));
+        memmove(free_ns + n_free, workers[t].free_ns, workers[t].free_count * sizeof(uint32_t));
+        n_alloc += workers[t].alloc_count;
+        n_free += workers[t].free_count;
+        failures += workers[t].failures;
+    }
+    const bench_latency_t la = bench_percentiles(alloc_ns, n_alloc);
+    const bench_latency_t lf = bench_percentiles(free_ns, n_free);
+    const double ops_per_sec = wall_ns ? (double)total * 1e9 / (double)wall_ns : 0.0;
+
+    ESP_LOGI(TAG, "%-13s thr=%d %-5s alloc=%2d%%: %10.0f ops/s  alloc p50/p99 %5u/%6u ns  free p50/p99 %5u/%6u ns  fail %u",
+             allocator->name, threads, dist->name, alloc_percent, ops_per_sec,
+             (unsigned)la.p50, (unsigned)la.p99, (unsigned)lf.p50, (unsigned)lf.p99, (unsigned)failures);
+
+    fprintf(f, "%s\n    {\"allocator\": \"%s\", \"threads\": %d, \"size_dist\": \"%s\", \"alloc_percent\": %d, "
+               "\"ops\": %u, \"wall_us\": %llu, \"ops_per_sec\": %.0f, \"failures\": %u, ",
+            first ? "" : ",", allocator->name, threads, dist->name, alloc_percent,
+            (unsigned)total, (unsigned long long)(wall_ns / 1000), ops_per_sec, (unsigned)failures);
+    json_latency(f, "alloc_ns", &la);
+    fprintf(f, ", ");
+    json_latency(f, "free_ns", &lf);
+    fprintf(f, "}");
+
+    free(alloc_ns);
+    free(free_ns);
+}
+
+static void bench_runner_task(void *pvParameters) {
+    const char* path = getenv(BENCH_JSON_ENV);
+    if (!path) path = BENCH_JSON_DEFAULT_PATH;
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open %s for writing", path);
+        exit(1);
+    }
+
+    fprintf(f, "{\n  \"suite\": \"alloc_bench_host\",\n  \"port\": \"FreeRTOS POSIX\",\n"
+               "  \"ops_per_thread\": %d,\n  \"slots_per_thread\": %d,\n  \"results\": [",
+            BENCH_OPS_PER_THREAD, BENCH_SLOTS_PER_THREAD);
+
+    bool first = true;
+    for (size_t a = 0; a < BENCH_COUNT_OF(bench_allocators); a++) {
+        const bench_allocator_t* allocator = &bench_allocators[a];
+        if (!allocator->init()) {
+            ESP_LOGW(TAG, "Skip %s (init failed)", allocator->name);
+            continue;
+        }
+        ESP_LOGI(TAG, "\n📏 ═══ %s ═══", allocator->name);
+        for (size_t t = 0; t < BENCH_COUNT_OF(bench_thread_counts); t++) {
+            for (size_t d = 0; d < BENCH_COUNT_OF(bench_dists); d++) {
+                for (size_t r = 0; r < BENCH_COUNT_OF(bench_alloc_percents); r++) {
+                    bench_run(f, first, allocator, bench_thread_counts[t], &bench_dists[d], bench_alloc_percents[r]);
+                    first = false;
+                }
+            }
+        }
+    }
+
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+    ESP_LOGI(TAG, "✅ Results written to %s", path);
+    exit(0);
+}
+
+void app_main(void) {
+    ESP_LOGI(TAG, "🚀 Host Allocator Benchmark Starting...");
+    ESP_LOGI(TAG, "Threads: 1-%d, sizes: small/mixed/large, alloc share: 50/67/80%%, %d ops per thread",
+             BENCH_MAX_THREADS, BENCH_OPS_PER_THREAD);
+    xTaskCreate(bench_runner_task, "BenchRunner", BENCH_STACK_SIZE, NULL, BENCH_RUNNER_PRIORITY, NULL);
+}
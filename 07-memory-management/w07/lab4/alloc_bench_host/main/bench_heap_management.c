@@ -0,0 +1,20 @@
+// heap_management.c built for the host benchmark: tracked_malloc/tracked_free
+// with the tracker app_main would set up, and per-call logging silenced
+#define app_main heap_management_app_main
+#include "heap_management.c"
+#undef app_main
+
+#include "alloc_bench.h"
+
+bool bench_tracked_init(void) {
+    esp_log_level_set(TAG, ESP_LOG_NONE);    // failures are counted by the runner
+    return tracking_init();
+}
+
+void* bench_tracked_alloc(size_t size) {
+    return tracked_malloc(size, MALLOC_CAP_8BIT, "Bench");
+}
+
+void bench_tracked_free(void* ptr) {
+    tracked_free(ptr, "Bench");
+}
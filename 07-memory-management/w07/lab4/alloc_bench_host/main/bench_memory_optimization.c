@@ -0,0 +1,21 @@
+// memory_optimization.c built for the host benchmark: the lock-free static
+// size classes, plus the kernel selection app_main does (SSE2/AVX2 on x86)
+#define app_main memory_optimization_app_main
+#include "memory_optimization.c"
+#undef app_main
+
+#include "alloc_bench.h"
+
+bool bench_static_init(void) {
+    esp_log_level_set(TAG, ESP_LOG_WARN);
+    mk_init();
+    return true;
+}
+
+void* bench_static_alloc(size_t size) {
+    return allocate_static_buffer(size);
+}
+
+void bench_static_free(void* ptr) {
+    free_static_buffer(ptr);
+}
@@ -0,0 +1,35 @@
+// memory_pools.c built for the host benchmark. app_main is renamed so only the
+// pools are set up; smart_pool_malloc is not used because it blinks an LED with a
+// 50 ms delay on every hit.
+#define app_main memory_pools_app_main
+#include "memory_pools.c"
+#undef app_main
+
+#include "alloc_bench.h"
+
+bool bench_pools_init(void) {
+    esp_log_level_set(TAG, ESP_LOG_ERROR);   // exhaustion warnings are counted as failures instead
+    memcpy(pool_active_configs, pool_configs, sizeof(pool_active_configs));
+    int ok_count = 0;
+    for (int i = 0; i < POOL_COUNT; i++) {
+        if (init_memory_pool(&pools[i], &pool_active_configs[i], i + 1)) ok_count++;
+    }
+    pools_initialized = ok_count > 0;
+    return pools_initialized;
+}
+
+// Same pool walk as smart_pool_malloc: smallest fitting pool first, larger ones when it is full
+void* bench_pools_alloc(size_t size) {
+    for (int i = 0; i < POOL_COUNT; i++) {
+        if (size <= pools[i].block_size) {
+            void* ptr = pool_malloc(&pools[i]);
+            if (ptr) return ptr;
+        }
+    }
+    return NULL;
+}
+
+void bench_pools_free(void* ptr) {
+    memory_pool_t* owner = pool_find_owner(ptr);
+    if (owner) pool_free(owner, ptr);
+}
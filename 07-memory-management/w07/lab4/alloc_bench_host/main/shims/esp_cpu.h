@@ -0,0 +1,14 @@
+// Host shim for esp_cpu.h: a cycle counter derived from CLOCK_MONOTONIC at the
+// ESP32 clock rate, so cycle-based statistics keep their on-target scale
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+#define esp_cpu_get_cycle_count shim_esp_cpu_get_cycle_count
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+// Host return addresses carry no register-window bits
+static inline uint32_t esp_cpu_process_stack_pc(uint32_t pc) { return pc; }
@@ -0,0 +1,56 @@
+// Host shim for esp_heap_caps.h: heap_caps_* on top of malloc, with a fixed-size
+// emulated internal heap and no PSRAM, so the labs take the same fallback paths
+// (SPIRAM -> internal, pool -> heap) as on a plain ESP32.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>     // the IDF header chain brings in malloc/free; the labs rely on it
+
+#define MALLOC_CAP_EXEC       (1 << 0)
+#define MALLOC_CAP_32BIT      (1 << 1)
+#define MALLOC_CAP_8BIT       (1 << 2)
+#define MALLOC_CAP_DMA        (1 << 3)
+#define MALLOC_CAP_SPIRAM     (1 << 10)
+#define MALLOC_CAP_INTERNAL   (1 << 11)
+#define MALLOC_CAP_DEFAULT    (1 << 12)
+
+#define SHIM_HEAP_BYTES       (300 * 1024)   // roughly the free DRAM of an ESP32 app
+
+// Renamed so the shims never clash with a heap component on the linux target
+#define heap_caps_malloc                  shim_heap_caps_malloc
+#define heap_caps_calloc                  shim_heap_caps_calloc
+#define heap_caps_realloc                 shim_heap_caps_realloc
+#define heap_caps_aligned_alloc           shim_heap_caps_aligned_alloc
+#define heap_caps_free                    shim_heap_caps_free
+#define heap_caps_get_free_size           shim_heap_caps_get_free_size
+#define heap_caps_get_minimum_free_size   shim_heap_caps_get_minimum_free_size
+#define heap_caps_get_largest_free_block  shim_heap_caps_get_largest_free_block
+#define heap_caps_get_total_size          shim_heap_caps_get_total_size
+#define heap_caps_check_integrity_all     shim_heap_caps_check_integrity_all
+#define heap_caps_print_heap_info         shim_heap_caps_print_heap_info
+#define heap_caps_get_info                shim_heap_caps_get_info
+
+typedef struct {
+    size_t total_free_bytes;
+    size_t total_allocated_bytes;
+    size_t largest_free_block;
+    size_t minimum_free_bytes;
+    size_t allocated_blocks;
+    size_t free_blocks;
+    size_t total_blocks;
+} multi_heap_info_t;
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps);
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps);
+void heap_caps_free(void* ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);   // no fragmentation model: equals free size
+size_t heap_caps_get_total_size(uint32_t caps);
+bool heap_caps_check_integrity_all(bool print_errors);
+void heap_caps_print_heap_info(uint32_t caps);
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps);     // byte totals only, no block counts
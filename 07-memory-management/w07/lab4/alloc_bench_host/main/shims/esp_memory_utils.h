@@ -0,0 +1,12 @@
+// Host shim for esp_memory_utils.h: the emulated heap has no PSRAM
+#pragma once
+
+#include <stdbool.h>
+
+static inline bool esp_ptr_external_ram(const void* p) {
+    return false;
+}
+
+static inline bool esp_ptr_internal(const void* p) {
+    return true;
+}
@@ -0,0 +1,11 @@
+// Host shim for esp_random.h: per-thread xorshift32, not a hardware RNG
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define esp_random      shim_esp_random
+#define esp_fill_random shim_esp_fill_random
+
+uint32_t esp_random(void);
+void esp_fill_random(void* buf, size_t len);
@@ -0,0 +1,252 @@
+// Host implementations of the ESP-IDF shims used by the allocator benchmark.
+// Every function here is only reachable through the renaming macros in the shim
+// headers, so nothing collides with components that do support the linux target.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "driver/gpio.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#ifndef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 160
+#endif
+
+#define SHIM_NVS_ENTRIES   8
+#define SHIM_NVS_KEY_LEN   16
+
+// ====== Heap ======
+static size_t shim_heap_used = 0;
+static size_t shim_heap_peak = 0;
+
+static bool shim_heap_reserve(size_t bytes) {
+    size_t used = __atomic_load_n(&shim_heap_used, __ATOMIC_RELAXED);
+    do {
+        if (used + bytes > SHIM_HEAP_BYTES) return false;
+    } while (!__atomic_compare_exchange_n(&shim_heap_used, &used, used + bytes, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    size_t peak = __atomic_load_n(&shim_heap_peak, __ATOMIC_RELAXED);
+    while (used + bytes > peak &&
+           !__atomic_compare_exchange_n(&shim_heap_peak, &peak, used + bytes, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return true;
+}
+
+static void* shim_heap_account(void* ptr) {
+    if (ptr && !shim_heap_reserve(malloc_usable_size(ptr))) {
+        free(ptr);
+        return NULL;
+    }
+    return ptr;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) return NULL;   // emulated board has no PSRAM
+    return shim_heap_account(malloc(size));
+}
+
+void* heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) return NULL;
+    return shim_heap_account(calloc(n, size));
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    if (!ptr) return heap_caps_malloc(size, caps);
+    if (caps & MALLOC_CAP_SPIRAM) return NULL;
+    const size_t old_size = malloc_usable_size(ptr);
+    // Reserve the growth up front: once realloc succeeds ptr is gone, so a
+    // failed reservation afterwards could neither free nor hand back the block
+    const size_t booked = size > old_size ? size : old_size;
+    if (booked > old_size && !shim_heap_reserve(booked - old_size)) return NULL;
+    void* grown = realloc(ptr, size);
+    if (!grown) {
+        __atomic_sub_fetch(&shim_heap_used, booked - old_size, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    // Settle the estimate against the usable size the allocator actually gave
+    const size_t new_size = malloc_usable_size(grown);
+    if (new_size > booked) __atomic_add_fetch(&shim_heap_used, new_size - booked, __ATOMIC_RELAXED);
+    else __atomic_sub_fetch(&shim_heap_used, booked - new_size, __ATOMIC_RELAXED);
+    return grown;
+}
+
+void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    void* ptr = NULL;
+    if (caps & MALLOC_CAP_SPIRAM) return NULL;
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    if (posix_memalign(&ptr, alignment, size) != 0) return NULL;
+    return shim_heap_account(ptr);
+}
+
+void heap_caps_free(void* ptr) {
+    if (!ptr) return;
+    __atomic_sub_fetch(&shim_heap_used, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) return 0;
+    return SHIM_HEAP_BYTES - __atomic_load_n(&shim_heap_used, __ATOMIC_RELAXED);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) return 0;
+    return SHIM_HEAP_BYTES - __atomic_load_n(&shim_heap_peak, __ATOMIC_RELAXED);
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : SHIM_HEAP_BYTES;
+}
+
+bool heap_caps_check_integrity_all(bool print_errors) {
+    return true;
+}
+
+void heap_caps_print_heap_info(uint32_t caps) {
+    printf("Heap summary (host shim): %u of %u bytes free, minimum %u\n",
+           (unsigned)heap_caps_get_free_size(caps), (unsigned)heap_caps_get_total_size(caps),
+           (unsigned)heap_caps_get_minimum_free_size(caps));
+}
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+    memset(info, 0, sizeof(*info));
+    info->total_free_bytes = heap_caps_get_free_size(caps);
+    info->total_allocated_bytes = heap_caps_get_total_size(caps) - info->total_free_bytes;
+    info->largest_free_block = heap_caps_get_largest_free_block(caps);
+    info->minimum_free_bytes = heap_caps_get_minimum_free_size(caps);
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+uint32_t esp_get_minimum_free_heap_size(void) {
+    return (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+}
+
+void esp_restart(void) {
+    exit(0);
+}
+
+// ====== Time ======
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    return (esp_cpu_cycle_count_t)(ns * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / 1000);
+}
+
+// ====== Random ======
+uint32_t esp_random(void) {
+    static __thread uint32_t state = 0;
+    if (state == 0) state = (uint32_t)esp_timer_get_time() ^ (uint32_t)(uintptr_t)&state ^ 0x9E3779B9u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+void esp_fill_random(void* buf, size_t len) {
+    uint8_t* out = (uint8_t*)buf;
+    for (size_t i = 0; i < len; i++) out[i] = (uint8_t)esp_random();
+}
+
+// ====== GPIO ======
+static uint32_t shim_gpio_levels[GPIO_NUM_MAX];
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+    return (gpio_num >= 0 && gpio_num < GPIO_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    shim_gpio_levels[gpio_num] = level;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    return (gpio_num >= 0 && gpio_num < GPIO_NUM_MAX) ? (int)shim_gpio_levels[gpio_num] : 0;
+}
+
+// ====== NVS (RAM only, one table for all namespaces) ======
+typedef struct {
+    char key[SHIM_NVS_KEY_LEN];
+    void* value;
+    size_t length;
+} shim_nvs_entry_t;
+
+static shim_nvs_entry_t shim_nvs[SHIM_NVS_ENTRIES];
+
+static shim_nvs_entry_t* shim_nvs_find(const char* key, bool create) {
+    shim_nvs_entry_t* empty = NULL;
+    for (int i = 0; i < SHIM_NVS_ENTRIES; i++) {
+        if (shim_nvs[i].value && strncmp(shim_nvs[i].key, key, SHIM_NVS_KEY_LEN) == 0) return &shim_nvs[i];
+        if (!shim_nvs[i].value && !empty) empty = &shim_nvs[i];
+    }
+    if (create && empty) strncpy(empty->key, key, SHIM_NVS_KEY_LEN - 1);
+    return create ? empty : NULL;
+}
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    for (int i = 0; i < SHIM_NVS_ENTRIES; i++) free(shim_nvs[i].value);
+    memset(shim_nvs, 0, sizeof(shim_nvs));
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* namespace_name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    const shim_nvs_entry_t* entry = shim_nvs_find(key, false);
+    if (!entry) return ESP_ERR_NVS_NOT_FOUND;
+    if (!out_value) {
+        *length = entry->length;
+        return ESP_OK;
+    }
+    if (*length < entry->length) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(out_value, entry->value, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    shim_nvs_entry_t* entry = shim_nvs_find(key, true);
+    if (!entry) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    void* copy = malloc(length ? length : 1);
+    if (!copy) return ESP_ERR_NO_MEM;
+    memcpy(copy, value, length);
+    free(entry->value);
+    entry->value = copy;
+    entry->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
@@ -0,0 +1,13 @@
+// Host shim for esp_system.h: heap figures come from the emulated heap
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define esp_get_free_heap_size         shim_esp_get_free_heap_size
+#define esp_get_minimum_free_heap_size shim_esp_get_minimum_free_heap_size
+#define esp_restart                    shim_esp_restart
+
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+void esp_restart(void) __attribute__((noreturn));
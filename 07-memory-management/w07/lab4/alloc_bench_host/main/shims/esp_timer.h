@@ -0,0 +1,8 @@
+// Host shim for esp_timer.h: only esp_timer_get_time (CLOCK_MONOTONIC)
+#pragma once
+
+#include <stdint.h>
+
+#define esp_timer_get_time shim_esp_timer_get_time
+
+int64_t esp_timer_get_time(void);
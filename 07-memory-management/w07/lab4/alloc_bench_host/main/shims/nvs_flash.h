@@ -0,0 +1,11 @@
+// Host shim for nvs_flash.h: NVS lives in RAM for the life of the process
+#pragma once
+
+#include "esp_err.h"
+#include "nvs.h"
+
+#define nvs_flash_init  shim_nvs_flash_init
+#define nvs_flash_erase shim_nvs_flash_erase
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
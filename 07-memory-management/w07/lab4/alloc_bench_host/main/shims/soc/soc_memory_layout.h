@@ -0,0 +1,9 @@
+// Host shim for soc/soc_memory_layout.h: there is no ESP32 address map on the host
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+static inline bool esp_ptr_internal(const void* p)   { (void)p; return true; }
+static inline bool esp_ptr_external_ram(const void* p) { (void)p; return false; }
+static inline bool esp_ptr_dma_capable(const void* p)  { (void)p; return true; }
@@ -13,6 +13,7 @@
 #include "esp_log.h"
 #include "esp_event.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
 #include "nvs_flash.h"
 
 #include "esp_wifi.h"
@@ -68,6 +69,11 @@
 /* GPTimer 1 kHz */
 #define TIMER_HZ             1000
 
+/* ISR block pool: ISR ยืมบล็อก เติมข้อมูล แล้วส่งแค่ pointer เข้าคิว */
+#define ISR_POOL_BLOCK_SIZE  32
+#define ISR_POOL_BLOCKS      32
+#define ISR_POOL_NIL         0xFFFF
+
 /* FreeRTOS prios (< configMAX_PRIORITIES=25) */
 #define PRI_TIMER_WORK       14
 #define PRI_WIFI_WORK        12
@@ -79,7 +85,8 @@
 /* ---------------- Globals ---------------- */
 static EventGroupHandle_t s_wifi_event_group;
 static QueueHandle_t s_btn_evt_q;
-static QueueHandle_t s_timer_q;
+static QueueHandle_t s_timer_q;       // timer_sample_t by value (copy path)
+static QueueHandle_t s_timer_ptr_q;   // timer_sample_t* (pool path)
 static SemaphoreHandle_t s_io_mutex;
 static spi_device_handle_t s_spi_dev;
 static i2c_master_bus_handle_t s_i2c_bus;
@@ -100,6 +107,75 @@ static shared_payload_t s_shared = {0};
 
 static inline uint64_t now_us(void) { return esp_timer_get_time(); }
 
+/* ---------------- ISR block pool ---------------- */
+// Lock-free fixed-block pool usable from ISRs and tasks alike (no mutex, no
+// critical section). Free blocks form a stack of indices; the head word packs
+// a 16-bit ABA tag with the top index so a stale CAS can never succeed.
+typedef struct {
+    uint8_t  mem[ISR_POOL_BLOCKS][ISR_POOL_BLOCK_SIZE] __attribute__((aligned(8)));
+    uint16_t next[ISR_POOL_BLOCKS];
+    uint32_t head;      // (tag << 16) | index
+    uint32_t drops;     // allocations that found the pool empty
+} isr_block_pool_t;
+
+static isr_block_pool_t s_isr_pool;
+
+static void isr_pool_init(isr_block_pool_t *pool)
+{
+    for (int i = 0; i < ISR_POOL_BLOCKS; ++i) {
+        pool->next[i] = (i + 1 < ISR_POOL_BLOCKS) ? (uint16_t)(i + 1) : ISR_POOL_NIL;
+    }
+    pool->head = 0;
+    pool->drops = 0;
+}
+
+static void * IRAM_ATTR isr_pool_alloc(isr_block_pool_t *pool)
+{
+    uint32_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    uint32_t idx, next;
+    do {
+        idx = head & 0xFFFF;
+        if (idx == ISR_POOL_NIL) {
+            __atomic_add_fetch(&pool->drops, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        next = (head & 0xFFFF0000) + 0x10000 + pool->next[idx];
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, next, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return pool->mem[idx];
+}
+
+static void IRAM_ATTR isr_pool_free(isr_block_pool_t *pool, void *block)
+{
+    const uint32_t idx = (uint32_t)(((uint8_t *)block - &pool->mem[0][0]) / ISR_POOL_BLOCK_SIZE);
+    uint32_t head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+    uint32_t next;
+    do {
+        pool->next[idx] = (uint16_t)(head & 0xFFFF);
+        next = (head & 0xFFFF0000) + 0x10000 + idx;
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, next, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/* ---------------- ISR timing ---------------- */
+typedef enum { ISR_PATH_COPY = 0, ISR_PATH_POOL = 1 } isr_path_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t cycles_total;
+    uint32_t cycles_max;
+    uint32_t failed;     // queue full or pool empty
+} isr_stats_t;
+
+static isr_stats_t s_isr_stats[2];
+static volatile bool s_isr_use_pool = false;   // timer worker สลับทุกหน้าต่าง TIMER_HZ ticks
+
+static inline void IRAM_ATTR isr_stats_record(isr_stats_t *st, uint32_t cycles, bool ok)
+{
+    st->count++;
+    st->cycles_total += cycles;
+    if (cycles > st->cycles_max) st->cycles_max = cycles;
+    if (!ok) st->failed++;
+}
+
 /* ---------------- Button ISR ---------------- */
 typedef struct {
     int64_t ts_us;
@@ -115,24 +191,60 @@ static void IRAM_ATTR btn_isr(void *arg)
     if (t - s_btn_last_us < 20000) return; // debounce 20ms
     s_btn_last_us = t;
 
-    btn_evt_t evt = {
-        .ts_us = t,
-        .pin   = (int)(intptr_t)arg,
-        .level = gpio_get_level(GPIO_BTN)
-    };
+    btn_evt_t *evt = isr_pool_alloc(&s_isr_pool);
+    if (!evt) return;   // นับไว้ใน s_isr_pool.drops
+    evt->ts_us = t;
+    evt->pin   = (int)(intptr_t)arg;
+    evt->level = gpio_get_level(GPIO_BTN);
+
     BaseType_t hpw = pdFALSE;
-    xQueueSendFromISR(s_btn_evt_q, &evt, &hpw);
+    if (xQueueSendFromISR(s_btn_evt_q, &evt, &hpw) != pdTRUE) isr_pool_free(&s_isr_pool, evt);
     if (hpw) portYIELD_FROM_ISR();
 }
 
 /* ---------------- GPTimer ISR ---------------- */
+typedef struct {
+    uint32_t tick;
+    uint32_t core;
+    int64_t  ts_us;
+    uint64_t alarm_value;
+} timer_sample_t;
+
+_Static_assert(sizeof(btn_evt_t) <= ISR_POOL_BLOCK_SIZE, "btn_evt_t must fit an ISR pool block");
+_Static_assert(sizeof(timer_sample_t) <= ISR_POOL_BLOCK_SIZE, "timer_sample_t must fit an ISR pool block");
+
 static bool IRAM_ATTR gptimer_on_alarm_cb(gptimer_handle_t timer,
                                           const gptimer_alarm_event_data_t *edata,
                                           void *user_ctx)
 {
-    uint32_t tick = (uint32_t) edata->count_value;
+    const uint32_t c0 = esp_cpu_get_cycle_count();
+    const isr_path_t path = s_isr_use_pool ? ISR_PATH_POOL : ISR_PATH_COPY;
     BaseType_t hpw = pdFALSE;
-    xQueueSendFromISR(s_timer_q, &tick, &hpw);
+    BaseType_t sent = pdFALSE;
+
+    if (path == ISR_PATH_POOL) {
+        // pool path: เติมข้อมูลลงบล็อกแล้วส่งแค่ pointer (4 bytes) เข้าคิว
+        timer_sample_t *s = isr_pool_alloc(&s_isr_pool);
+        if (s) {
+            s->tick        = (uint32_t) edata->count_value;
+            s->core        = xPortGetCoreID();
+            s->ts_us       = now_us();
+            s->alarm_value = edata->alarm_value;
+            sent = xQueueSendFromISR(s_timer_ptr_q, &s, &hpw);
+            if (sent != pdTRUE) isr_pool_free(&s_isr_pool, s);
+        }
+    } else {
+        // copy path: คิวต้อง copy ทั้ง struct
+        timer_sample_t s = {
+            .tick        = (uint32_t) edata->count_value,
+            .core        = xPortGetCoreID(),
+            .ts_us       = now_us(),
+            .alarm_value = edata->alarm_value,
+        };
+        sent = xQueueSendFromISR(s_timer_q, &s, &hpw);
+    }
+
+    isr_stats_record(&s_isr_stats[path], esp_cpu_get_cycle_count() - c0, sent == pdTRUE);
     return hpw == pdTRUE;
 }
 
@@ -412,18 +524,49 @@ static void timer_worker_task(void *arg)
     ESP_ERROR_CHECK(gptimer_enable(timer));
     ESP_ERROR_CHECK(gptimer_start(timer));
 
-    uint32_t tick;
+    timer_sample_t sample;
     uint32_t acc = 0;
     uint64_t t0 = now_us();
     while (1) {
-        if (xQueueReceive(s_timer_q, &tick, portMAX_DELAY) == pdTRUE) {
-            acc++;
-            if (acc % 1000 == 0) {
-                uint64_t t1 = now_us();
-                double hz = (double)acc * 1e6 / (double)(t1 - t0);
-                ESP_LOGI(TAG_PERIPH, "Timer rate ~ %.1f Hz", hz);
-                acc = 0;
-                t0 = t1;
+        bool got = false;
+        if (s_isr_use_pool) {
+            timer_sample_t *s;
+            if (xQueueReceive(s_timer_ptr_q, &s, pdMS_TO_TICKS(100)) == pdTRUE) {
+                sample = *s;
+                isr_pool_free(&s_isr_pool, s);
+                got = true;
+            }
+        } else {
+            got = xQueueReceive(s_timer_q, &sample, pdMS_TO_TICKS(100)) == pdTRUE;
+        }
+        if (!got) continue;
+
+        acc++;
+        if (acc % 1000 == 0) {
+            uint64_t t1 = now_us();
+            double hz = (double)acc * 1e6 / (double)(t1 - t0);
+            ESP_LOGI(TAG_PERIPH, "Timer rate ~ %.1f Hz (last tick %" PRIu32 " on core %" PRIu32 ")",
+                     hz, sample.tick, sample.core);
+            acc = 0;
+            t0 = t1;
+
+            // สลับ path ก่อน แล้วค่อยอ่านสถิติของ path เดิม (ISR เขียนอีกช่องแล้ว)
+            const isr_path_t done = s_isr_use_pool ? ISR_PATH_POOL : ISR_PATH_COPY;
+            s_isr_use_pool = !s_isr_use_pool;
+            isr_stats_t st = s_isr_stats[done];
+            memset(&s_isr_stats[done], 0, sizeof(isr_stats_t));
+            if (st.count > 0) {
+                ESP_LOGI(TAG_PERIPH, "Timer ISR [%s path] avg %" PRIu32 " cycles, max %" PRIu32 ", failed %" PRIu32 "/%" PRIu32,
+                         done == ISR_PATH_POOL ? "pool" : "copy",
+                         st.cycles_total / st.count, st.cycles_max, st.failed, st.count);
+            }
+
+            // ISR รันบน core เดียวกับ task นี้ จึงไม่มีรายการใหม่เข้าคิวเดิมหลังสลับแล้ว
+            if (done == ISR_PATH_POOL) {
+                timer_sample_t *s;
+                while (xQueueReceive(s_timer_ptr_q, &s, 0) == pdTRUE) isr_pool_free(&s_isr_pool, s);
+            } else {
+                while (xQueueReceive(s_timer_q, &sample, 0) == pdTRUE) {}
             }
         }
     }
@@ -433,7 +576,7 @@ static void timer_worker_task(void *arg)
 static void button_task(void *arg)
 {
     ESP_LOGI(TAG_PERIPH, "Button task start on Core %d", xPortGetCoreID());
-    btn_evt_t evt;
+    btn_evt_t *p;
 
     gpio_config_t io_btn = {
         .pin_bit_mask = 1ULL<<GPIO_BTN,
@@ -450,7 +593,9 @@ static void button_task(void *arg)
     gpio_set_direction(GPIO_LED, GPIO_MODE_OUTPUT);
 
     while (1) {
-        if (xQueueReceive(s_btn_evt_q, &evt, portMAX_DELAY) == pdTRUE) {
+        if (xQueueReceive(s_btn_evt_q, &p, portMAX_DELAY) == pdTRUE) {
+            btn_evt_t evt = *p;
+            isr_pool_free(&s_isr_pool, p);
             ESP_LOGI(TAG_PERIPH, "Button evt: pin=%d level=%d ts=%" PRId64 " us",
                      evt.pin, evt.level, evt.ts_us);
             gpio_set_level(GPIO_LED, evt.level ? 1 : 0);
@@ -482,10 +627,10 @@ static void background_task(void *arg)
         snap = s_shared;
         xSemaphoreGive(s_io_mutex);
 
-        ESP_LOGI(TAG_PERIPH, "Free heap: %u bytes | seq=%" PRIu32
+        ESP_LOGI(TAG_PERIPH, "Free heap: %u bytes | ISR pool drops=%" PRIu32 " | seq=%" PRIu32
                              " i2c_whoami=0x%02X spi_echo=0x%08" PRIx32
                              " updated=%" PRIu64 " us",
-                 (unsigned)free_heap, snap.seq, snap.last_i2c_whoami,
+                 (unsigned)free_heap, __atomic_load_n(&s_isr_pool.drops, __ATOMIC_RELAXED), snap.seq, snap.last_i2c_whoami,
                  snap.last_spi_echo, snap.last_update_us);
         vTaskDelay(pdMS_TO_TICKS(5000));
     }
@@ -497,8 +642,10 @@ void app_main(void)
     ESP_LOGI(TAG_PERIPH, "Peripheral Integration Demo; Main on Core %d", xPortGetCoreID());
     ESP_ERROR_CHECK(nvs_flash_init());
 
-    s_btn_evt_q = xQueueCreate(16, sizeof(btn_evt_t));
-    s_timer_q   = xQueueCreate(32, sizeof(uint32_t));
+    isr_pool_init(&s_isr_pool);
+    s_btn_evt_q   = xQueueCreate(16, sizeof(btn_evt_t *));
+    s_timer_q     = xQueueCreate(32, sizeof(timer_sample_t));
+    s_timer_ptr_q = xQueueCreate(32, sizeof(timer_sample_t *));
     s_io_mutex  = xSemaphoreCreateMutex();
 
     wifi_init_sta();
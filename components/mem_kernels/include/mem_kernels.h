@@ -0,0 +1,21 @@
+// Copy / fill / checksum kernels with a portable 32-bit word path and SSE2 /
+// AVX2 paths on x86 host builds. mk_init() checks every variant against libc
+// (and a byte-wise checksum reference), times the ones that pass, and routes
+// mk_copy / mk_fill / mk_checksum to the fastest.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Self-test + boot-time micro-benchmark; call once before the kernels are used.
+// Until then they run the portable word variant.
+void mk_init(void);
+
+void* mk_copy(void* dst, const void* src, size_t n);     // memcpy semantics (no overlap)
+void* mk_fill(void* dst, int value, size_t n);           // memset semantics
+
+// Sum of the buffer as little-endian 32-bit words (zero-padded tail), mod 2^32
+uint32_t mk_checksum(const void* data, size_t n);
+
+// Selected variant and measured throughput per kernel
+void mk_print_selection(void);
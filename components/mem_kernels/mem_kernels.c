@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_random.h"
+#include "mem_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MK_HAVE_X86 1
+#else
+#define MK_HAVE_X86 0
+#endif
+
+static const char *TAG = "MEM_KERNELS";
+
+// Self-test and selection configuration
+#define MK_TEST_MAX          4096
+#define MK_TEST_GUARD        16          // guard bytes checked after every destination
+#define MK_BENCH_BYTES       4096
+#define MK_BENCH_ROUNDS      16          // best of N runs
+
+enum { MK_COPY, MK_FILL, MK_CHECKSUM, MK_KERNELS };
+static const char* const mk_kernel_names[MK_KERNELS] = { "copy", "fill", "checksum" };
+
+typedef void* (*mk_copy_fn_t)(void* dst, const void* src, size_t n);
+typedef void* (*mk_fill_fn_t)(void* dst, int value, size_t n);
+typedef uint32_t (*mk_checksum_fn_t)(const void* data, size_t n);
+
+// Word accesses through this type may alias any object
+typedef uint32_t __attribute__((may_alias)) mk_word_t;
+
+// ====== Portable variants ======
+
+// Checksum of bytes whose offset from the buffer start is a multiple of 4
+static uint32_t mk_sum_tail(const uint8_t* p, size_t n) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += (uint32_t)p[i] << ((i & 3) * 8);
+    }
+    return sum;
+}
+
+// Reference definition of the checksum
+static uint32_t mk_checksum_byte(const void* data, size_t n) {
+    return mk_sum_tail(data, n);
+}
+
+// Word path only when src and dst share their alignment (Xtensa faults on
+// unaligned word access); 32 bytes per iteration
+static void* mk_copy_word(void* dst, const void* src, size_t n) {
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+
+    if ((((uintptr_t)d ^ (uintptr_t)s) & 3) == 0) {
+        while (n && ((uintptr_t)d & 3)) {
+            *d++ = *s++;
+            n--;
+        }
+        mk_word_t* dw = (mk_word_t*)d;
+        const mk_word_t* sw = (const mk_word_t*)s;
+        for (; n >= 32; n -= 32, dw += 8, sw += 8) {
+            const uint32_t a = sw[0], b = sw[1], c = sw[2], e = sw[3];
+            const uint32_t f = sw[4], g = sw[5], h = sw[6], k = sw[7];
+            dw[0] = a; dw[1] = b; dw[2] = c; dw[3] = e;
+            dw[4] = f; dw[5] = g; dw[6] = h; dw[7] = k;
+        }
+        for (; n >= 4; n -= 4) {
+            *dw++ = *sw++;
+        }
+        d = (uint8_t*)dw;
+        s = (const uint8_t*)sw;
+    }
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+static void* mk_fill_word(void* dst, int value, size_t n) {
+    uint8_t* d = dst;
+    const uint32_t pattern = (uint8_t)value * 0x01010101u;
+
+    while (n && ((uintptr_t)d & 3)) {
+        *d++ = (uint8_t)value;
+        n--;
+    }
+    mk_word_t* dw = (mk_word_t*)d;
+    for (; n >= 32; n -= 32, dw += 8) {
+        dw[0] = pattern; dw[1] = pattern; dw[2] = pattern; dw[3] = pattern;
+        dw[4] = pattern; dw[5] = pattern; dw[6] = pattern; dw[7] = pattern;
+    }
+    for (; n >= 4; n -= 4) {
+        *dw++ = pattern;
+    }
+    d = (uint8_t*)dw;
+    while (n--) {
+        *d++ = (uint8_t)value;
+    }
+    return dst;
+}
+
+// Word loads need an aligned start; anything else takes the byte path
+static uint32_t mk_checksum_word(const void* data, size_t n) {
+    if ((uintptr_t)data & 3) return mk_checksum_byte(data, n);
+
+    const mk_word_t* w = data;
+    uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t words = n / 4;
+    for (; words >= 4; words -= 4, w += 4) {
+        s0 += w[0]; s1 += w[1]; s2 += w[2]; s3 += w[3];
+    }
+    for (; words; words--) {
+        s0 += *w++;
+    }
+    return s0 + s1 + s2 + s3 + mk_sum_tail((const uint8_t*)w, n & 3);
+}
+
+// ====== x86 host variants (unaligned vector loads, runtime CPU check) ======
+#if MK_HAVE_X86
+static bool mk_has_sse2(void) { return __builtin_cpu_supports("sse2"); }
+static bool mk_has_avx2(void) { return __builtin_cpu_supports("avx2"); }
+
+__attribute__((target("sse2")))
+static void* mk_copy_sse2(void* dst, const void* src, size_t n) {
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    for (; n >= 64; n -= 64, d += 64, s += 64) {
+        const __m128i a = _mm_loadu_si128((const __m128i*)s);
+        const __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+        const __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+        const __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+        _mm_storeu_si128((__m128i*)d, a);
+        _mm_storeu_si128((__m128i*)(d + 16), b);
+        _mm_storeu_si128((__m128i*)(d + 32), c);
+        _mm_storeu_si128((__m128i*)(d + 48), e);
+    }
+    mk_copy_word(d, s, n);
+    return dst;
+}
+
+__attribute__((target("sse2")))
+static void* mk_fill_sse2(void* dst, int value, size_t n) {
+    uint8_t* d = dst;
+    const __m128i v = _mm_set1_epi8((char)value);
+    for (; n >= 64; n -= 64, d += 64) {
+        _mm_storeu_si128((__m128i*)d, v);
+        _mm_storeu_si128((__m128i*)(d + 16), v);
+        _mm_storeu_si128((__m128i*)(d + 32), v);
+        _mm_storeu_si128((__m128i*)(d + 48), v);
+    }
+    mk_fill_word(d, value, n);
+    return dst;
+}
+
+__attribute__((target("sse2")))
+static uint32_t mk_checksum_sse2(const void* data, size_t n) {
+    const uint8_t* p = data;
+    __m128i a0 = _mm_setzero_si128(), a1 = _mm_setzero_si128();
+    for (; n >= 32; n -= 32, p += 32) {
+        a0 = _mm_add_epi32(a0, _mm_loadu_si128((const __m128i*)p));
+        a1 = _mm_add_epi32(a1, _mm_loadu_si128((const __m128i*)(p + 16)));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, _mm_add_epi32(a0, a1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + mk_sum_tail(p, n);
+}
+
+__attribute__((target("avx2")))
+static void* mk_copy_avx2(void* dst, const void* src, size_t n) {
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    for (; n >= 128; n -= 128, d += 128, s += 128) {
+        const __m256i a = _mm256_loadu_si256((const __m256i*)s);
+        const __m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+        const __m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+        const __m256i e = _mm256_loadu_si256((const __m256i*)(s + 96));
+        _mm256_storeu_si256((__m256i*)d, a);
+        _mm256_storeu_si256((__m256i*)(d + 32), b);
+        _mm256_storeu_si256((__m256i*)(d + 64), c);
+        _mm256_storeu_si256((__m256i*)(d + 96), e);
+    }
+    mk_copy_sse2(d, s, n);
+    return dst;
+}
+
+__attribute__((target("avx2")))
+static void* mk_fill_avx2(void* dst, int value, size_t n) {
+    uint8_t* d = dst;
+    const __m256i v = _mm256_set1_epi8((char)value);
+    for (; n >= 128; n -= 128, d += 128) {
+        _mm256_storeu_si256((__m256i*)d, v);
+        _mm256_storeu_si256((__m256i*)(d + 32), v);
+        _mm256_storeu_si256((__m256i*)(d + 64), v);
+        _mm256_storeu_si256((__m256i*)(d + 96), v);
+    }
+    mk_fill_sse2(d, value, n);
+    return dst;
+}
+
+__attribute__((target("avx2")))
+static uint32_t mk_checksum_avx2(const void* data, size_t n) {
+    const uint8_t* p = data;
+    __m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256();
+    for (; n >= 64; n -= 64, p += 64) {
+        a0 = _mm256_add_epi32(a0, _mm256_loadu_si256((const __m256i*)p));
+        a1 = _mm256_add_epi32(a1, _mm256_loadu_si256((const __m256i*)(p + 32)));
+    }
+    uint32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi32(a0, a1));
+    uint32_t sum = 0;
+    for (int i = 0; i < 8; i++) {
+        sum += lanes[i];
+    }
+    return sum + mk_checksum_sse2(p, n);     // p is still a multiple of 4 from the start
+}
+#endif
+
+// ====== Variant table and dispatch ======
+typedef struct {
+    const char* name;
+    mk_copy_fn_t copy;              // NULL: no variant for this kernel
+    mk_fill_fn_t fill;
+    mk_checksum_fn_t checksum;
+    bool (*supported)(void);        // NULL: always available
+} mk_variant_t;
+
+static const mk_variant_t mk_variants[] = {
+    { "libc",   memcpy,       memset,       NULL,             NULL },
+    { "byte",   NULL,         NULL,         mk_checksum_byte, NULL },
+    { "word32", mk_copy_word, mk_fill_word, mk_checksum_word, NULL },
+#if MK_HAVE_X86
+    { "sse2",   mk_copy_sse2, mk_fill_sse2, mk_checksum_sse2, mk_has_sse2 },
+    { "avx2",   mk_copy_avx2, mk_fill_avx2, mk_checksum_avx2, mk_has_avx2 },
+#endif
+};
+
+#define MK_VARIANTS (sizeof(mk_variants) / sizeof(mk_variants[0]))
+
+static mk_copy_fn_t mk_copy_impl = mk_copy_word;
+static mk_fill_fn_t mk_fill_impl = mk_fill_word;
+static mk_checksum_fn_t mk_checksum_impl = mk_checksum_word;
+
+static int mk_selected[MK_KERNELS] = { -1, -1, -1 };
+static float mk_mbps[MK_VARIANTS][MK_KERNELS];     // 0 = not available or failed the self-test
+
+void* mk_copy(void* dst, const void* src, size_t n) {
+    return mk_copy_impl(dst, src, n);
+}
+
+void* mk_fill(void* dst, int value, size_t n) {
+    return mk_fill_impl(dst, value, n);
+}
+
+uint32_t mk_checksum(const void* data, size_t n) {
+    return mk_checksum_impl(data, n);
+}
+
+static bool mk_has_kernel(const mk_variant_t* v, int kernel) {
+    return kernel == MK_COPY ? v->copy != NULL : kernel == MK_FILL ? v->fill != NULL : v->checksum != NULL;
+}
+
+// ====== Self-test against libc / the byte reference ======
+static const size_t mk_test_sizes[] = { 0, 1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65,
+                                        127, 128, 129, 255, 256, 1000, MK_TEST_MAX - 3 };
+
+static bool mk_self_test(const mk_variant_t* v, int kernel, uint8_t* src, uint8_t* dst, uint8_t* ref) {
+    const size_t span = MK_TEST_MAX + MK_TEST_GUARD + 4;
+
+    // No kernel writes src, so one random fill serves every size/offset case
+    for (size_t i = 0; i < span; i += sizeof(uint32_t)) {
+        const uint32_t r = esp_random();
+        memcpy(src + i, &r, span - i < sizeof(r) ? span - i : sizeof(r));
+    }
+
+    for (size_t t = 0; t < sizeof(mk_test_sizes) / sizeof(mk_test_sizes[0]); t++) {
+        const size_t n = mk_test_sizes[t];
+        for (int soff = 0; soff < 4; soff++) {
+            for (int doff = 0; doff < 4; doff++) {
+                const uint8_t value = src[(t * 16 + soff * 4 + doff) % span];   // fill byte per case
+                memset(dst, 0xA5, span);
+                memset(ref, 0xA5, span);
+
+                bool ok;
+                if (kernel == MK_COPY) {
+                    memcpy(ref + doff, src + soff, n);
+                    ok = v->copy(dst + doff, src + soff, n) == dst + doff && memcmp(dst, ref, span) == 0;
+                } else if (kernel == MK_FILL) {
+                    memset(ref + doff, value, n);
+                    ok = v->fill(dst + doff, value, n) == dst + doff && memcmp(dst, ref, span) == 0;
+                } else {
+                    ok = v->checksum(src + soff, n) == mk_checksum_byte(src + soff, n);
+                }
+                if (!ok) {
+                    ESP_LOGE(TAG, "❌ %s %s failed: n=%u src+%d dst+%d", v->name, mk_kernel_names[kernel],
+                             (unsigned)n, soff, doff);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static float mk_measure_mbps(const mk_variant_t* v, int kernel, uint8_t* src, uint8_t* dst) {
+    uint32_t best = UINT32_MAX;
+    volatile uint32_t sink = 0;
+
+    for (int r = 0; r < MK_BENCH_ROUNDS; r++) {
+        const uint32_t start = esp_cpu_get_cycle_count();
+        if (kernel == MK_COPY) {
+            v->copy(dst, src, MK_BENCH_BYTES);
+        } else if (kernel == MK_FILL) {
+            v->fill(dst, r, MK_BENCH_BYTES);
+        } else {
+            sink += v->checksum(src, MK_BENCH_BYTES);
+        }
+        const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+        if (cycles < best) best = cycles;
+    }
+    (void)sink;
+    return best ? (float)MK_BENCH_BYTES * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ / best : 0;
+}
+
+void mk_init(void) {
+    const size_t span = MK_TEST_MAX + MK_TEST_GUARD + 4;
+    uint8_t* src = heap_caps_malloc(span, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t* dst = heap_caps_malloc(span, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t* ref = heap_caps_malloc(span, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!src || !dst || !ref) {
+        ESP_LOGE(TAG, "No memory for the kernel self-test, keeping word32");
+        heap_caps_free(src);
+        heap_caps_free(dst);
+        heap_caps_free(ref);
+        return;
+    }
+
+    for (int k = 0; k < MK_KERNELS; k++) {
+        int best = -1;
+        for (size_t v = 0; v < MK_VARIANTS; v++) {
+            const mk_variant_t* variant = &mk_variants[v];
+            mk_mbps[v][k] = 0;
+            if (!mk_has_kernel(variant, k) || (variant->supported && !variant->supported())) continue;
+            if (!mk_self_test(variant, k, src, dst, ref)) continue;
+
+            mk_mbps[v][k] = mk_measure_mbps(variant, k, src, dst);
+            if (best < 0 || mk_mbps[v][k] > mk_mbps[best][k]) best = v;
+        }
+        mk_selected[k] = best;
+    }
+
+    if (mk_selected[MK_COPY] >= 0) mk_copy_impl = mk_variants[mk_selected[MK_COPY]].copy;
+    if (mk_selected[MK_FILL] >= 0) mk_fill_impl = mk_variants[mk_selected[MK_FILL]].fill;
+    if (mk_selected[MK_CHECKSUM] >= 0) mk_checksum_impl = mk_variants[mk_selected[MK_CHECKSUM]].checksum;
+
+    heap_caps_free(src);
+    heap_caps_free(dst);
+    heap_caps_free(ref);
+
+    mk_print_selection();
+}
+
+void mk_print_selection(void) {
+    ESP_LOGI(TAG, "\n⚙️ ═══ MEMORY KERNELS (%d-byte aligned buffers, MB/s) ═══", MK_BENCH_BYTES);
+    ESP_LOGI(TAG, "Variant       copy      fill  checksum");
+    for (size_t v = 0; v < MK_VARIANTS; v++) {
+        char cells[MK_KERNELS][16];
+        for (int k = 0; k < MK_KERNELS; k++) {
+            if (mk_mbps[v][k] > 0) {
+                snprintf(cells[k], sizeof(cells[k]), "%8.0f%s", mk_mbps[v][k], mk_selected[k] == (int)v ? "*" : " ");
+            } else {
+                snprintf(cells[k], sizeof(cells[k]), "%8s ", "-");
+            }
+        }
+        ESP_LOGI(TAG, "%-8s  %s %s %s", mk_variants[v].name, cells[0], cells[1], cells[2]);
+    }
+    ESP_LOGI(TAG, "* = selected for mk_copy / mk_fill / mk_checksum");
+    ESP_LOGI(TAG, "═══════════════════════════════════════");
+}
@@ -0,0 +1,78 @@
+// Structure-of-arrays table / ring for hot scan loops.
+//
+// Fields a loop scans ("hot") get one packed array each; everything else stays
+// together in one struct per row ("cold"), so a scan touches only the bytes it
+// reads. Columns are an X-macro list that takes the callback and one argument:
+//
+//     #define SAMPLE_COLUMNS(X, arg) X(uint32_t, duration_us, arg) X(bool, accuracy_ok, arg)
+//     typedef struct { uint32_t timer_id; ... } sample_cold_t;
+//     SOA_DECLARE(samples, SAMPLE_COLUMNS, sample_cold_t)
+//
+// which declares samples_t with `uint32_t* duration_us`, `bool* accuracy_ok`,
+// `sample_cold_t* cold` and:
+//     samples_bytes(capacity)           storage needed (runtime)
+//     samples_bind(&t, storage, cap)    carve the columns out of storage
+//     samples_push(&t)                  ring: claim the next slot, overwriting the oldest
+//     samples_recent(&t, age)           ring: slot of the age-th newest entry (0 = newest, age < capacity)
+//     samples_col_duration_us(&t)       column base pointer, one accessor per hot column
+//
+// Static storage: static uint8_t buf[SOA_STATIC_BYTES(SAMPLE_COLUMNS, sample_cold_t, N)] SOA_STORAGE_ALIGN;
+// Not thread-safe: callers keep their existing locking.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SOA_ALIGN                 8     // every column starts 8-byte aligned (uint64_t columns)
+#define SOA_ALIGN_UP(bytes)       (((bytes) + SOA_ALIGN - 1) & ~(size_t)(SOA_ALIGN - 1))
+#define SOA_STORAGE_ALIGN         __attribute__((aligned(SOA_ALIGN)))
+
+// Column callbacks
+#define SOA_COLUMN_PTR(type, name, arg)       type* name;
+#define SOA_COLUMN_BYTES(type, name, cap)     + SOA_ALIGN_UP(sizeof(type) * (cap))
+#define SOA_COLUMN_BIND(type, name, t)        (t)->name = (type*)p; p += SOA_ALIGN_UP(sizeof(type) * (t)->capacity);
+#define SOA_COLUMN_ACCESSOR(type, name, prefix) \
+    static inline type* prefix##_col_##name(const prefix##_t* t) { return t->name; }
+
+// Compile-time storage size, for static buffers
+#define SOA_STATIC_BYTES(COLUMNS, cold_type, cap) \
+    ((size_t)0 COLUMNS(SOA_COLUMN_BYTES, cap) + SOA_ALIGN_UP(sizeof(cold_type) * (cap)))
+
+#define SOA_DECLARE(prefix, COLUMNS, cold_type)                                         \
+    typedef struct {                                                                    \
+        COLUMNS(SOA_COLUMN_PTR, _)                                                      \
+        cold_type* cold;                                                                \
+        uint32_t capacity;                                                              \
+        uint32_t head;          /* ring: next slot to write */                          \
+        uint32_t count;         /* ring: valid entries, <= capacity */                  \
+    } prefix##_t;                                                                       \
+                                                                                        \
+    static inline size_t prefix##_bytes(uint32_t capacity) {                            \
+        return SOA_STATIC_BYTES(COLUMNS, cold_type, capacity);                          \
+    }                                                                                   \
+                                                                                        \
+    /* storage must be SOA_ALIGN-aligned and prefix##_bytes(capacity) long */           \
+    static inline void prefix##_bind(prefix##_t* t, void* storage, uint32_t capacity) { \
+        uint8_t* p = (uint8_t*)storage;                                                 \
+        t->capacity = capacity;                                                         \
+        t->head = 0;                                                                    \
+        t->count = 0;                                                                   \
+        COLUMNS(SOA_COLUMN_BIND, t)                                                     \
+        t->cold = (cold_type*)p;                                                        \
+    }                                                                                   \
+                                                                                        \
+    static inline uint32_t prefix##_push(prefix##_t* t) {                               \
+        const uint32_t slot = t->head;                                                  \
+        t->head = slot + 1 == t->capacity ? 0 : slot + 1;                               \
+        if (t->count < t->capacity) t->count++;                                         \
+        return slot;                                                                    \
+    }                                                                                   \
+                                                                                        \
+    /* one conditional subtract instead of a modulo: the index is < 2 * capacity */     \
+    static inline uint32_t prefix##_recent(const prefix##_t* t, uint32_t age) {         \
+        const uint32_t idx = t->head + t->capacity - 1 - age;                           \
+        return idx >= t->capacity ? idx - t->capacity : idx;                            \
+    }                                                                                   \
+                                                                                        \
+    COLUMNS(SOA_COLUMN_ACCESSOR, prefix)